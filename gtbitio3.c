@@ -8,8 +8,13 @@
 #include <string.h>
 #include <stdint.h>  /* C99 */
 #include "gtbitio3.h"
+#if !defined( _WIN32 )
+	#include <unistd.h>   /* ftruncate */
+#endif
+#include "gtdirect.c"
 
 FILE *gIN = NULL, *pOUT = NULL;
+int pOUT_direct = 0;   /* output through the gtdirect backend. */
 unsigned int pBUFSIZE = 8192, gBUFSIZE = 8192;
 unsigned char *pbuf = NULL, *pbuf_start = NULL, p_cnt = 0;
 unsigned char *gbuf = NULL, *gbuf_start = NULL, *gbuf_end = NULL, g_cnt = 0;
@@ -75,6 +80,17 @@ void init_get_buffer( void )
 	gbuf_end = (unsigned char *) (gbuf + nfread);
 }
 
+/* repositions the input file and refills the get buffer. */
+void seek_get_buffer( int64_t offset )
+{
+	gt_fseek( gIN, offset, SEEK_SET );
+	g_cnt = 0;
+	nbytes_read = offset;
+	gbuf = gbuf_start;
+	nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
+	gbuf_end = (unsigned char *) (gbuf + nfread);
+}
+
 void free_put_buffer( void )
 {
 	pbuf = pbuf_start;
@@ -89,12 +105,77 @@ void free_get_buffer( void )
 
 void flush_put_buffer( void )
 {
-	if ( pbuf_count || p_cnt ) {
-		fwrite( pbuf_start, pbuf_count+(p_cnt?1:0), 1, pOUT );
-		nbytes_out += (pbuf_count+(p_cnt?1:0));
+	unsigned int n = pbuf_count+(p_cnt?1:0);
+	
+	if ( n ) {
+		pfwrite( pbuf_start, n );
+		nbytes_out += n;
 		pbuf = pbuf_start; pbuf_count = 0; p_cnt = 0;
-		memset( pbuf, 0, pBUFSIZE );
+		memset( pbuf, 0, n );   /* only what was written is dirty. */
+	}
+}
+
+/* Output file: stdio, or direct I/O (gtdirect.c) when direct is set
+	and the file system supports it.
+*/
+int open_put_file( const char *fname, int direct )
+{
+	pOUT_direct = 0;
+	if ( !strcmp( fname, "-" ) ) {  /* stdout; can't be rewritten. */
+		pOUT = stdout;
+		return 1;
+	}
+	if ( direct ) {
+		if ( dio_open( fname ) ) {
+			pOUT_direct = 1;
+			return 1;
+		}
+		fprintf(stderr, "\n O_DIRECT not available, using buffered output.");
 	}
+	/* readable too: a dedup decode copies from earlier output. */
+	return ( pOUT = fopen( fname, "w+b" ) ) != NULL;
+}
+
+/* Opens an existing output file to write on at offset size; what
+	follows is cut off. stdio only.
+*/
+int reopen_put_file( const char *fname, int64_t size )
+{
+	pOUT_direct = 0;
+	if ( (pOUT = fopen( fname, "r+b" )) == NULL ) return 0;
+#if !defined( _WIN32 )
+	fflush( pOUT );
+	if ( ftruncate( fileno( pOUT ), size ) ) return 0;
+#endif
+	return gt_fseek( pOUT, size, SEEK_SET ) == 0;
+}
+
+/* overwrite n bytes at offset, e.g. the file stamp; keeps the write position. */
+void rewrite_put_file( int64_t offset, const void *p, unsigned int n )
+{
+	if ( pOUT_direct ) dio_rewrite( offset, p, n );
+	else {
+		gt_fseek( pOUT, offset, SEEK_SET );
+		fwrite( p, n, 1, pOUT );
+		gt_fseek( pOUT, 0, SEEK_END );
+	}
+}
+
+int close_put_file( void )
+{
+	if ( pOUT_direct ) {
+		pOUT_direct = 0;
+		return dio_close();
+	}
+	if ( pOUT ) return fclose( pOUT );
+	return 0;
+}
+
+/* Writes n bytes from p to the output file. */
+static inline void pfwrite( const void *p, unsigned int n )
+{
+	if ( pOUT_direct ) dio_write( (const unsigned char *) p, n );
+	else fwrite( p, n, 1, pOUT );
 }
 
 static inline int get_bit( void )
@@ -164,7 +245,7 @@ static inline void pfputc( int c )
 {
 	*pbuf++ = (unsigned char) c;
 	if ( (++pbuf_count) == pBUFSIZE ){
-		fwrite( pbuf_start, pBUFSIZE, 1, pOUT );
+		pfwrite( pbuf_start, pBUFSIZE );
 		nbytes_out += pBUFSIZE;
 		pbuf_count = 0;
 		pbuf = pbuf_start;
@@ -223,7 +304,7 @@ static inline void put_nbits( unsigned int k, int size )
 		k >>= (8-p_cnt);
 		p_cnt = 0;
 		if ( (++pbuf_count) == pBUFSIZE ){
-			fwrite( pbuf_start, pBUFSIZE, 1, pOUT );
+			pfwrite( pbuf_start, pBUFSIZE );
 			nbytes_out += pBUFSIZE;
 			pbuf_count = 0;
 			pbuf = pbuf_start;
@@ -237,7 +318,7 @@ static inline void put_nbits( unsigned int k, int size )
 				size -= 8;
 				k >>= 8;
 				if ( (++pbuf_count) == pBUFSIZE ){
-					fwrite( pbuf_start, pBUFSIZE, 1, pOUT );
+					pfwrite( pbuf_start, pBUFSIZE );
 					nbytes_out += pBUFSIZE;
 					pbuf_count = 0;
 					pbuf = pbuf_start;
@@ -26,6 +26,15 @@ number of bits.
 	#endif
 #endif
 
+/* 64-bit file offsets. */
+#if defined( _WIN32 )
+	#define gt_fseek _fseeki64
+	#define gt_ftell _ftelli64
+#else
+	#define gt_fseek fseeko
+	#define gt_ftell ftello
+#endif
+
 #define pset_bit() *pbuf |= (1<<p_cnt)
 
 /* ---- writes a ONE (1) bit. ---- */
@@ -41,7 +50,7 @@ number of bits.
 		p_cnt = 0; \
 		if ( (++pbuf_count) == pBUFSIZE ){ \
 			pbuf = pbuf_start; \
-			fwrite( pbuf, pBUFSIZE, 1, pOUT ); \
+			pfwrite( pbuf, pBUFSIZE ); \
 			memset( pbuf, 0, pBUFSIZE ); \
 			pbuf_count = 0; \
 			nbytes_out += pBUFSIZE; \
@@ -65,6 +74,7 @@ number of bits.
 }
 
 extern FILE *gIN, *pOUT;
+extern int pOUT_direct;
 extern unsigned int pBUFSIZE, gBUFSIZE;
 extern unsigned char *pbuf, *pbuf_start, p_cnt;
 extern unsigned char *gbuf, *gbuf_start, *gbuf_end, g_cnt;
@@ -75,9 +85,15 @@ extern int64_t nbytes_out, nbytes_read;
 void init_buffer_sizes( unsigned int size );
 void init_put_buffer( void );
 void init_get_buffer( void );
+void seek_get_buffer( int64_t offset );
 void free_put_buffer( void );
 void free_get_buffer( void );
 void flush_put_buffer( void );
+int  open_put_file( const char *fname, int direct );
+int  reopen_put_file( const char *fname, int64_t size );
+void rewrite_put_file( int64_t offset, const void *p, unsigned int n );
+int  close_put_file( void );
+static inline void pfwrite( const void *p, unsigned int n );
 static inline int  get_bit( void );
 static inline int  gfgetc( void );
 static inline void pfputc( int c );
@@ -0,0 +1,85 @@
+/*
+	Filename:  GTCRC.C, Ver. 1, 10/18/2026
+	Author:    Gerald R. Tamayo
+	Written:   (2026)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+#include "gtcrc.h"
+
+#define CRC32C_POLY  0x82f63b78   /* reflected */
+
+static uint32_t crc32c_table[8][256];
+static int crc32c_hw = 0;
+
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+#include <nmmintrin.h>
+
+__attribute__(( target("sse4.2") ))
+static uint32_t crc32c_sse42( uint32_t crc, const unsigned char *p, size_t n )
+{
+	uint64_t c = crc;
+	
+	while ( n && ((uintptr_t) p & 7) ) {
+		c = _mm_crc32_u8( (uint32_t) c, *p++ );
+		n--;
+	}
+	while ( n >= 8 ) {
+		c = _mm_crc32_u64( c, *(const uint64_t *) p );
+		p += 8; n -= 8;
+	}
+	while ( n-- ) c = _mm_crc32_u8( (uint32_t) c, *p++ );
+	return (uint32_t) c;
+}
+#endif
+
+void crc32c_init( void )
+{
+	uint32_t c;
+	int i, k;
+	
+	for ( i = 0; i < 256; i++ ) {
+		c = i;
+		for ( k = 0; k < 8; k++ ) c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : (c >> 1);
+		crc32c_table[0][i] = c;
+	}
+	for ( i = 0; i < 256; i++ ) {
+		c = crc32c_table[0][i];
+		for ( k = 1; k < 8; k++ ) {
+			c = crc32c_table[0][c & 0xff] ^ (c >> 8);
+			crc32c_table[k][i] = c;
+		}
+	}
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+	__builtin_cpu_init();
+	crc32c_hw = __builtin_cpu_supports( "sse4.2" );
+#endif
+}
+
+/* slicing-by-8 where there is no crc32 instruction. */
+uint32_t crc32c( uint32_t crc, const void *buf, size_t n )
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	uint32_t c = ~crc, lo, hi;
+	
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+	if ( crc32c_hw ) return ~crc32c_sse42( c, p, n );
+#endif
+	while ( n && ((uintptr_t) p & 7) ) {
+		c = crc32c_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+		n--;
+	}
+	while ( n >= 8 ) {
+		lo = c ^ ((uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24);
+		hi = (uint32_t) p[4] | (uint32_t) p[5] << 8 | (uint32_t) p[6] << 16 | (uint32_t) p[7] << 24;
+		c = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff]
+			^ crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24]
+			^ crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff]
+			^ crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+		p += 8; n -= 8;
+	}
+	while ( n-- ) c = crc32c_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+	return ~c;
+}
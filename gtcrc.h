@@ -0,0 +1,19 @@
+/* GTCRC.H, Ver. 1, 10/18/2026 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>  /* C99 */
+
+#if !defined( GTCRC_H )
+	#define GTCRC_H
+
+/* CRC32C (Castagnoli), as used by iSCSI, ext4 and SSE4.2.
+
+	crc32c_init() builds the slicing-by-8 tables and selects the
+	SSE4.2 crc32 instruction when the CPU has it; call it once before
+	any crc32c(). Start with crc = 0; crc32c( crc32c(0,a,n), b, m )
+	equals the CRC of a followed by b.
+*/
+void crc32c_init( void );
+uint32_t crc32c( uint32_t crc, const void *p, size_t n );
+
+#endif
@@ -0,0 +1,320 @@
+/*
+	Filename:  GTDIRECT.C, Ver. 1, 10/18/2026
+	Author:    Gerald R. Tamayo
+	Written:   (2026)
+
+	Direct I/O output backend, see gtdirect.h.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+#include "gtdirect.h"
+
+/* O_DIRECT needs _GNU_SOURCE defined before the first system
+	header, i.e. at the top of the program that includes this file.
+*/
+#if defined( __linux__ )
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined( O_DIRECT )
+
+#if defined( __NR_io_uring_setup ) && defined( __NR_io_uring_enter )
+	#define DIO_URING
+	#include <linux/io_uring.h>
+#endif
+
+static int dio_fd = -1, dio_err = 0;
+static unsigned char *dio_pool[ DIO_NBUFS ];
+static unsigned int dio_len[ DIO_NBUFS ];   /* bytes in flight, 0 = free */
+static int64_t dio_pos[ DIO_NBUFS ];        /* file offset of the write */
+static int dio_cur = 0;
+static unsigned int dio_fill = 0;
+static int64_t dio_off = 0;   /* file offset of the current buffer. */
+
+/* header rewrites that fall outside the current buffer. */
+#define DIO_NPATCH  8
+static struct {
+	int64_t offset;
+	unsigned int n;
+	unsigned char *p;
+} dio_patch[ DIO_NPATCH ];
+static int dio_npatch = 0;
+
+/* synchronous write of n bytes at offset; handles short writes. */
+static void dio_pwrite( const unsigned char *p, unsigned int n, int64_t offset )
+{
+	ssize_t k;
+
+	while ( n && !dio_err ) {
+		k = pwrite( dio_fd, p, n, (off_t) offset );
+		if ( k < 0 ) {
+			if ( errno == EINTR ) continue;
+			fprintf(stderr, "\n write error (O_DIRECT)!");
+			dio_err = 1;
+		}
+		else {
+			p += k; n -= (unsigned int) k; offset += k;
+		}
+	}
+}
+
+#if defined( DIO_URING )
+
+static struct {
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_sz, cq_sz, sqes_sz;
+} ring = { .fd = -1 };
+
+static int uring_init( void )
+{
+	struct io_uring_params prm;
+
+	memset( &prm, 0, sizeof(prm) );
+	ring.fd = (int) syscall( __NR_io_uring_setup, DIO_NBUFS, &prm );
+	if ( ring.fd < 0 ) return 0;
+
+	ring.sq_sz = prm.sq_off.array + prm.sq_entries * sizeof(unsigned);
+	ring.cq_sz = prm.cq_off.cqes + prm.cq_entries * sizeof(struct io_uring_cqe);
+	if ( prm.features & IORING_FEAT_SINGLE_MMAP ) {
+		if ( ring.cq_sz > ring.sq_sz ) ring.sq_sz = ring.cq_sz;
+		ring.cq_sz = 0;
+	}
+	ring.sq_ptr = mmap( NULL, ring.sq_sz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING );
+	if ( ring.sq_ptr == MAP_FAILED ) goto fail;
+	if ( ring.cq_sz ) {
+		ring.cq_ptr = mmap( NULL, ring.cq_sz, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING );
+		if ( ring.cq_ptr == MAP_FAILED ) {
+			munmap( ring.sq_ptr, ring.sq_sz );
+			goto fail;
+		}
+	}
+	else ring.cq_ptr = ring.sq_ptr;
+	ring.sqes_sz = prm.sq_entries * sizeof(struct io_uring_sqe);
+	ring.sqes = (struct io_uring_sqe *) mmap( NULL, ring.sqes_sz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, ring.fd, IORING_OFF_SQES );
+	if ( ring.sqes == MAP_FAILED ) {
+		if ( ring.cq_sz ) munmap( ring.cq_ptr, ring.cq_sz );
+		munmap( ring.sq_ptr, ring.sq_sz );
+		goto fail;
+	}
+	ring.sq_head  = (unsigned *) ((char *) ring.sq_ptr + prm.sq_off.head);
+	ring.sq_tail  = (unsigned *) ((char *) ring.sq_ptr + prm.sq_off.tail);
+	ring.sq_mask  = (unsigned *) ((char *) ring.sq_ptr + prm.sq_off.ring_mask);
+	ring.sq_array = (unsigned *) ((char *) ring.sq_ptr + prm.sq_off.array);
+	ring.cq_head  = (unsigned *) ((char *) ring.cq_ptr + prm.cq_off.head);
+	ring.cq_tail  = (unsigned *) ((char *) ring.cq_ptr + prm.cq_off.tail);
+	ring.cq_mask  = (unsigned *) ((char *) ring.cq_ptr + prm.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *) ((char *) ring.cq_ptr + prm.cq_off.cqes);
+	return 1;
+
+	fail:
+	close( ring.fd );
+	ring.fd = -1;
+	return 0;
+}
+
+static void uring_free( void )
+{
+	if ( ring.fd < 0 ) return;
+	munmap( ring.sqes, ring.sqes_sz );
+	if ( ring.cq_sz ) munmap( ring.cq_ptr, ring.cq_sz );
+	munmap( ring.sq_ptr, ring.sq_sz );
+	close( ring.fd );
+	ring.fd = -1;
+}
+
+/* queue one IORING_OP_WRITE of buffer i; returns 0 if the kernel refused it.
+	Without SQPOLL only io_uring_enter() takes SQEs: one it did not take
+	is withdrawn, so the caller can pwrite() the buffer and reuse it.
+*/
+static int uring_submit( int i )
+{
+	unsigned tail = *ring.sq_tail, idx = tail & *ring.sq_mask;
+	struct io_uring_sqe *sqe = &ring.sqes[ idx ];
+
+	memset( sqe, 0, sizeof(*sqe) );
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = dio_fd;
+	sqe->addr = (uint64_t) (uintptr_t) dio_pool[i];
+	sqe->len = dio_len[i];
+	sqe->off = (uint64_t) dio_pos[i];
+	sqe->user_data = (uint64_t) i;
+	ring.sq_array[ idx ] = idx;
+	__atomic_store_n( ring.sq_tail, tail+1, __ATOMIC_RELEASE );
+	if ( syscall( __NR_io_uring_enter, ring.fd, 1, 0, 0, NULL, 0 ) == 1 ) return 1;
+	if ( __atomic_load_n( ring.sq_head, __ATOMIC_ACQUIRE ) != tail ) return 1;  /* taken: reaped later. */
+	__atomic_store_n( ring.sq_tail, tail, __ATOMIC_RELEASE );
+	return 0;
+}
+
+/* reap completions; if wait, block until at least one arrives. */
+static void uring_reap( int wait )
+{
+	unsigned head, tail;
+	struct io_uring_cqe *cqe;
+	int i, n = 0;
+
+	while ( 1 ) {
+		head = *ring.cq_head;
+		tail = __atomic_load_n( ring.cq_tail, __ATOMIC_ACQUIRE );
+		while ( head != tail ) {
+			cqe = &ring.cqes[ head & *ring.cq_mask ];
+			i = (int) cqe->user_data;
+			if ( cqe->res < 0 ) {  /* retry synchronously; reports the error. */
+				dio_pwrite( dio_pool[i], dio_len[i], dio_pos[i] );
+			}
+			else if ( (unsigned int) cqe->res < dio_len[i] ) {  /* short write */
+				dio_pwrite( dio_pool[i] + cqe->res, dio_len[i] - cqe->res,
+					dio_pos[i] + cqe->res );
+			}
+			dio_len[i] = 0;
+			head++, n++;
+		}
+		__atomic_store_n( ring.cq_head, head, __ATOMIC_RELEASE );
+		if ( n || !wait ) break;
+		syscall( __NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 );
+	}
+}
+#endif  /* DIO_URING */
+
+/* write out the (full) current buffer and switch to the next free one. */
+static void dio_submit( void )
+{
+	int i = dio_cur;
+
+	dio_len[i] = dio_fill;
+	dio_pos[i] = dio_off;
+	dio_off += dio_fill;
+	dio_fill = 0;
+#if defined( DIO_URING )
+	if ( ring.fd >= 0 && uring_submit( i ) ) {
+		dio_cur = (dio_cur+1) % DIO_NBUFS;
+		while ( dio_len[ dio_cur ] ) uring_reap( 1 );
+		return;
+	}
+#endif
+	dio_pwrite( dio_pool[i], dio_len[i], dio_pos[i] );
+	dio_len[i] = 0;
+	dio_cur = (dio_cur+1) % DIO_NBUFS;
+}
+
+int dio_open( const char *fname )
+{
+	int i;
+
+	dio_fd = open( fname, O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT, 0644 );
+	if ( dio_fd < 0 ) return 0;  /* e.g. tmpfs: no O_DIRECT support. */
+	for ( i = 0; i < DIO_NBUFS; i++ ) {
+		if ( posix_memalign( (void **) &dio_pool[i], DIO_ALIGN, DIO_BUFSIZE ) ) {
+			while ( i-- ) free( dio_pool[i] );
+			close( dio_fd );
+			dio_fd = -1;
+			return 0;
+		}
+		dio_len[i] = 0;
+	}
+	dio_cur = 0, dio_fill = 0, dio_off = 0;
+	dio_err = 0, dio_npatch = 0;
+#if defined( DIO_URING )
+	uring_init();
+#endif
+	return 1;
+}
+
+void dio_write( const unsigned char *p, unsigned int n )
+{
+	unsigned int k;
+
+	while ( n ) {
+		k = DIO_BUFSIZE - dio_fill;
+		if ( k > n ) k = n;
+		memcpy( dio_pool[ dio_cur ] + dio_fill, p, k );
+		dio_fill += k;
+		p += k; n -= k;
+		if ( dio_fill == DIO_BUFSIZE ) dio_submit();
+	}
+}
+
+/* overwrite already written bytes (e.g. the file stamp). */
+void dio_rewrite( int64_t offset, const void *p, unsigned int n )
+{
+	if ( offset >= dio_off && offset+n <= dio_off+dio_fill ) {
+		memcpy( dio_pool[ dio_cur ] + (offset-dio_off), p, n );
+	}
+	else if ( dio_npatch < DIO_NPATCH ) {
+		dio_patch[ dio_npatch ].offset = offset;
+		dio_patch[ dio_npatch ].n = n;
+		dio_patch[ dio_npatch ].p = (unsigned char *) malloc( n );
+		if ( dio_patch[ dio_npatch ].p == NULL ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+		memcpy( dio_patch[ dio_npatch++ ].p, p, n );
+	}
+	else {
+		fprintf(stderr, "\n too many header rewrites (O_DIRECT)!");
+		dio_err = 1;
+	}
+}
+
+int dio_close( void )
+{
+	unsigned int aligned;
+	int i;
+
+#if defined( DIO_URING )
+	if ( ring.fd >= 0 ) {
+		for ( i = 0; i < DIO_NBUFS; i++ )
+			while ( dio_len[i] ) uring_reap( 1 );
+		uring_free();
+	}
+#endif
+	/* the aligned part of the last buffer still goes out O_DIRECT. */
+	aligned = dio_fill & ~(DIO_ALIGN-1);
+	if ( aligned ) dio_pwrite( dio_pool[ dio_cur ], aligned, dio_off );
+
+	/* unaligned tail and header rewrites: through the page cache. */
+	fcntl( dio_fd, F_SETFL, fcntl( dio_fd, F_GETFL ) & ~O_DIRECT );
+	if ( dio_fill > aligned ) {
+		dio_pwrite( dio_pool[ dio_cur ] + aligned, dio_fill - aligned, dio_off + aligned );
+	}
+	for ( i = 0; i < dio_npatch; i++ ) {
+		dio_pwrite( dio_patch[i].p, dio_patch[i].n, dio_patch[i].offset );
+		free( dio_patch[i].p );
+	}
+	/* drop the few pages we did cache. */
+	fdatasync( dio_fd );
+	posix_fadvise( dio_fd, 0, 0, POSIX_FADV_DONTNEED );
+
+	for ( i = 0; i < DIO_NBUFS; i++ ) free( dio_pool[i] );
+	if ( close( dio_fd ) ) dio_err = 1;
+	dio_fd = -1;
+	return dio_err ? -1 : 0;
+}
+
+#define DIO_SUPPORTED
+#endif  /* O_DIRECT */
+#endif  /* __linux__ */
+
+#if !defined( DIO_SUPPORTED )
+int  dio_open( const char *fname ) { (void) fname; return 0; }
+void dio_write( const unsigned char *p, unsigned int n ) { (void) p; (void) n; }
+void dio_rewrite( int64_t offset, const void *p, unsigned int n )
+	{ (void) offset; (void) p; (void) n; }
+int  dio_close( void ) { return 0; }
+#endif
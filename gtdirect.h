@@ -0,0 +1,31 @@
+/* GTDIRECT.H, Ver. 1, 10/18/2026 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+
+#if !defined( GTDIRECT_H )
+	#define GTDIRECT_H
+
+/* Direct (page-cache bypassing) output backend for the gtbitio3
+	flush points.
+
+	Output bytes are staged in a pool of aligned buffers and written
+	with O_DIRECT at aligned file offsets: batched through io_uring
+	when the kernel has it, plain pwrite() otherwise. The unaligned
+	tail and any header rewrites are written after O_DIRECT has been
+	cleared on the descriptor, in dio_close().
+
+	On systems without O_DIRECT dio_open() fails and the caller
+	falls back to stdio.
+*/
+#define DIO_ALIGN     4096
+#define DIO_BUFSIZE   (1<<20)   /* must be a multiple of DIO_ALIGN. */
+#define DIO_NBUFS     4
+
+int  dio_open( const char *fname );
+void dio_write( const unsigned char *p, unsigned int n );
+void dio_rewrite( int64_t offset, const void *p, unsigned int n );
+int  dio_close( void );
+
+#endif
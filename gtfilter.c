@@ -0,0 +1,182 @@
+/*
+	Filename:  GTFILTER.C, Ver. 1, 10/18/2026
+	Author:    Gerald R. Tamayo
+	Written:   (2026)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+#include "gtfilter.h"
+
+#if defined( __SSE2__ )
+	#include <emmintrin.h>
+#endif
+
+static const char *filter_names[ FILTER_MAX+1 ] = {
+	"none", "delta1", "delta2", "delta4", "delta8", "x86", "planes2", "planes4", "planes8"
+};
+
+int filter_id( const char *name )
+{
+	int i;
+
+	for ( i = 0; i <= FILTER_MAX; i++ )
+		if ( !strcmp( name, filter_names[i] ) ) return i;
+	return -1;
+}
+
+const char *filter_name( int id )
+{
+	return ( id >= 0 && id <= FILTER_MAX ) ? filter_names[id] : "?";
+}
+
+/* ---- delta ---- */
+
+static void delta_fwd( const unsigned char *in, unsigned char *out, int n, int w )
+{
+	int i = 0;
+
+	for ( ; i < w && i < n; i++ ) out[i] = in[i];
+#if defined( __SSE2__ )
+	for ( ; i + 16 <= n; i += 16 ) {
+		_mm_storeu_si128( (__m128i *) (out+i), _mm_sub_epi8(
+			_mm_loadu_si128( (const __m128i *) (in+i) ),
+			_mm_loadu_si128( (const __m128i *) (in+i-w) ) ) );
+	}
+#endif
+	for ( ; i < n; i++ ) out[i] = in[i] - in[i-w];
+}
+
+#if defined( __SSE2__ )
+/* prefix sums of stride w inside a vector; the carry is the last w
+	decoded bytes repeated.
+*/
+#define DELTA_INV_SSE2( w, SHIFTS, CARRY ) \
+	for ( ; i + 16 <= n; i += 16 ) { \
+		__m128i v = _mm_loadu_si128( (__m128i *) (p+i) ); \
+		SHIFTS \
+		v = _mm_add_epi8( v, CARRY ); \
+		_mm_storeu_si128( (__m128i *) (p+i), v ); \
+	}
+#define SUM( k )  v = _mm_add_epi8( v, _mm_slli_si128( v, k ) );
+#endif
+
+static void delta_inv( unsigned char *p, int n, int w )
+{
+	int i = w;
+
+#if defined( __SSE2__ )
+	uint16_t c2;
+	uint32_t c4;
+	int64_t c8;
+
+	switch ( w ) {
+		case 1: DELTA_INV_SSE2( 1, SUM(1) SUM(2) SUM(4) SUM(8), _mm_set1_epi8( (char) p[i-1] ) ) break;
+		case 2: DELTA_INV_SSE2( 2, SUM(2) SUM(4) SUM(8),
+			(memcpy( &c2, p+i-2, 2 ), _mm_set1_epi16( (short) c2 )) ) break;
+		case 4: DELTA_INV_SSE2( 4, SUM(4) SUM(8),
+			(memcpy( &c4, p+i-4, 4 ), _mm_set1_epi32( (int) c4 )) ) break;
+		case 8: DELTA_INV_SSE2( 8, SUM(8),
+			(memcpy( &c8, p+i-8, 8 ), _mm_set1_epi64x( c8 )) ) break;
+	}
+#endif
+	for ( ; i < n; i++ ) p[i] += p[i-w];
+}
+
+/* ---- x86 E8/E9 ---- */
+
+/* next position >= i (and < end) with an E8 or E9 byte, or end. */
+static int x86_next( const unsigned char *p, int i, int end )
+{
+#if defined( __SSE2__ )
+	const __m128i fe = _mm_set1_epi8( (char) 0xfe ), e8 = _mm_set1_epi8( (char) 0xe8 );
+	int m;
+
+	for ( ; i + 16 <= end; i += 16 ) {
+		m = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128(
+			_mm_loadu_si128( (const __m128i *) (p+i) ), fe ), e8 ) );
+		if ( m ) return i + __builtin_ctz( m );
+	}
+#endif
+	for ( ; i < end; i++ ) if ( (p[i] & 0xfe) == 0xe8 ) return i;
+	return end;
+}
+
+/* the opcode bytes are not changed, so both directions find the same
+	instructions; a target is relative to the next instruction.
+*/
+static void x86_conv( unsigned char *p, int n, int encode )
+{
+	uint32_t a;
+	int i = 0;
+
+	while ( (i = x86_next( p, i, n-4 )) < n-4 ) {
+		a = p[i+1] | p[i+2] << 8 | p[i+3] << 16 | (uint32_t) p[i+4] << 24;
+		a = encode ? a + (uint32_t) (i+5) : a - (uint32_t) (i+5);
+		p[i+1] = a, p[i+2] = a >> 8, p[i+3] = a >> 16, p[i+4] = a >> 24;
+		i += 5;
+	}
+}
+
+/* ---- byte planes ---- */
+
+static void planes_fwd( const unsigned char *in, unsigned char *out, int n, int w )
+{
+	int j, r, m = n / w;
+
+	for ( j = 0; j < w; j++ ) {
+		const unsigned char *s = in + j;
+		for ( r = 0; r < m; r++ ) *out++ = s[r*w];
+	}
+	memcpy( out, in + m*w, n - m*w );
+}
+
+static int planes_inv( unsigned char *p, int n, int w )
+{
+	unsigned char *t = (unsigned char *) malloc( n ? n : 1 );
+	int j, r, m = n / w;
+
+	if ( !t ) return 0;
+	memcpy( t, p, n );
+	for ( j = 0; j < w; j++ ) {
+		const unsigned char *s = t + j*m;
+		for ( r = 0; r < m; r++ ) p[r*w + j] = s[r];
+	}
+	free( t );
+	return 1;
+}
+
+void filter_fwd( int id, const unsigned char *in, unsigned char *out, int n )
+{
+	switch ( id ) {
+		case FILTER_DELTA1: case FILTER_DELTA2: case FILTER_DELTA4: case FILTER_DELTA8:
+			delta_fwd( in, out, n, 1 << (id - FILTER_DELTA1) );
+			break;
+		case FILTER_X86:
+			memcpy( out, in, n );
+			x86_conv( out, n, 1 );
+			break;
+		case FILTER_PLANES2: case FILTER_PLANES4: case FILTER_PLANES8:
+			planes_fwd( in, out, n, 2 << (id - FILTER_PLANES2) );
+			break;
+		default:
+			memcpy( out, in, n );
+	}
+}
+
+int filter_inv( int id, unsigned char *p, int n )
+{
+	switch ( id ) {
+		case FILTER_NONE: return 1;
+		case FILTER_DELTA1: case FILTER_DELTA2: case FILTER_DELTA4: case FILTER_DELTA8:
+			delta_inv( p, n, 1 << (id - FILTER_DELTA1) );
+			return 1;
+		case FILTER_X86:
+			x86_conv( p, n, 0 );
+			return 1;
+		case FILTER_PLANES2: case FILTER_PLANES4: case FILTER_PLANES8:
+			return planes_inv( p, n, 2 << (id - FILTER_PLANES2) );
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+/* GTFILTER.H, Ver. 1, 10/18/2026 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+
+#if !defined( GTFILTER_H )
+	#define GTFILTER_H
+
+/* Reversible block filters, run before a byte-context model so that
+	arithmetic redundancy becomes literal redundancy:
+
+	delta1..delta8   p[i] - p[i-w]: samples of width w (1,2,4,8 bytes).
+	x86              E8/E9 call/jump targets made absolute (from the
+	                 block start), so calls to one target repeat.
+	planes2..planes8 byte-plane transposition of w-byte records: all
+	                 first bytes, then all second bytes, ...
+
+	The filter ids are stored in files; never renumber them.
+	filter_fwd() writes to out (not in place); filter_inv() decodes in
+	place. delta and the x86 opcode scan use SSE2 where available.
+*/
+#define FILTER_NONE      0
+#define FILTER_DELTA1    1
+#define FILTER_DELTA2    2
+#define FILTER_DELTA4    3
+#define FILTER_DELTA8    4
+#define FILTER_X86       5
+#define FILTER_PLANES2   6
+#define FILTER_PLANES4   7
+#define FILTER_PLANES8   8
+#define FILTER_MAX       8
+
+int  filter_id( const char *name );   /* -1 if unknown. */
+const char *filter_name( int id );
+void filter_fwd( int id, const unsigned char *in, unsigned char *out, int n );
+int  filter_inv( int id, unsigned char *p, int n );   /* 0 if id is unknown. */
+
+#endif
@@ -0,0 +1,110 @@
+/*
+	Filename:  GTLZ.C, Ver. 1, 10/18/2026
+	Author:    Gerald R. Tamayo
+	Written:   (2026)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+#include "gtlz.h"
+
+static inline uint32_t lz_read32( const unsigned char *p )
+{
+	uint32_t v;
+
+	memcpy( &v, p, 4 );
+	return v;
+}
+
+static inline uint32_t lz_hash( uint32_t v )
+{
+	return (v * 2654435761U) >> (32 - LZ_HASHBITS);
+}
+
+/* a length of 15 or more goes on in 255-continued bytes. */
+static inline unsigned char *lz_putlen( unsigned char *op, int len )
+{
+	for ( len -= 15; len >= 255; len -= 255 ) *op++ = 255;
+	*op++ = (unsigned char) len;
+	return op;
+}
+
+int lz_compress( const unsigned char *in, int n, unsigned char *out, int outmax )
+{
+	static int ht[ 1<<LZ_HASHBITS ];
+	unsigned char *op = out, *oend = out + outmax;
+	int ip = 0, anchor = 0, ref, lit, len;
+	uint32_t h;
+
+	memset( ht, -1, sizeof(ht) );
+	while ( ip + LZ_MINMATCH <= n ) {
+		h = lz_hash( lz_read32( in+ip ) );
+		ref = ht[h];
+		ht[h] = ip;
+		if ( ref < 0 || ip - ref > 65535 || lz_read32( in+ref ) != lz_read32( in+ip ) ) {
+			ip += 1 + ((ip - anchor) >> 6);   /* skip faster through literals. */
+			continue;
+		}
+		for ( len = LZ_MINMATCH; ip + len < n && in[ref+len] == in[ip+len]; len++ ) ;
+		lit = ip - anchor;
+		if ( op + 1 + lit + lit/255 + 2 + len/255 + 2 > oend ) return 0;
+		*op = (unsigned char) ((lit < 15 ? lit : 15) << 4 | (len-4 < 15 ? len-4 : 15));
+		op++;
+		if ( lit >= 15 ) op = lz_putlen( op, lit );
+		memcpy( op, in + anchor, lit );
+		op += lit;
+		*op++ = (unsigned char) (ip - ref);
+		*op++ = (unsigned char) ((ip - ref) >> 8);
+		if ( len-4 >= 15 ) op = lz_putlen( op, len-4 );
+		ip += len;
+		anchor = ip;
+		if ( ip - 2 >= 0 && ip + 2 <= n ) ht[ lz_hash( lz_read32( in+ip-2 ) ) ] = ip-2;
+	}
+	/* last literals */
+	lit = n - anchor;
+	if ( op + 1 + lit + lit/255 + 1 >= oend ) return 0;
+	*op++ = (unsigned char) ((lit < 15 ? lit : 15) << 4);
+	if ( lit >= 15 ) op = lz_putlen( op, lit );
+	memcpy( op, in + anchor, lit );
+	op += lit;
+	return (int) (op - out);
+}
+
+const unsigned char *lz_decompress( const unsigned char *src, const unsigned char *send,
+	unsigned char *dst, int n )
+{
+	unsigned char *op = dst, *oend = dst + n, *ref;
+	int token, lit, len, c;
+
+	while ( 1 ) {
+		if ( src >= send ) return NULL;
+		token = *src++;
+		if ( (lit = token >> 4) == 15 ) {
+			do {
+				if ( src >= send ) return NULL;
+				lit += c = *src++;
+			} while ( c == 255 );
+		}
+		if ( lit > send - src || lit > oend - op ) return NULL;
+		memcpy( op, src, lit );
+		op += lit, src += lit;
+		if ( op == oend ) return src;
+		if ( send - src < 2 ) return NULL;
+		ref = op - (src[0] | src[1] << 8);
+		src += 2;
+		if ( (len = token & 15) == 15 ) {
+			do {
+				if ( src >= send ) return NULL;
+				len += c = *src++;
+			} while ( c == 255 );
+		}
+		len += LZ_MINMATCH;
+		if ( ref < dst || ref == op || len > oend - op ) return NULL;
+		if ( op - ref >= len ) {
+			memcpy( op, ref, len );
+			op += len;
+		}
+		else while ( len-- ) *op++ = *ref++;   /* overlapping: a repeat */
+	}
+}
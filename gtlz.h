@@ -0,0 +1,30 @@
+/* GTLZ.H, Ver. 1, 10/18/2026 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>  /* C99 */
+
+#if !defined( GTLZ_H )
+	#define GTLZ_H
+
+/* A fast byte-oriented LZ77 in the LZ4 block style, single-probe
+	hash, 64 KB window. A sequence is
+
+		token: literal count (hi 4 bits), match length - 4 (lo 4 bits);
+		       15 means more follows in 255-continued bytes
+		the literals
+		match offset (16-bit LE), unless the output is complete
+
+	lz_compress() returns the coded size, or 0 if it is not smaller
+	than outmax. lz_decompress() decodes exactly n bytes and returns
+	the end of the coded data, or NULL if it is corrupt.
+*/
+#define LZ_MINMATCH   4
+#define LZ_HASHBITS   14
+#define LZ_MAXOUT(n)  ((n) + (n)/255 + 16)
+
+int lz_compress( const unsigned char *in, int n, unsigned char *out, int outmax );
+const unsigned char *lz_decompress( const unsigned char *src, const unsigned char *send,
+	unsigned char *dst, int n );
+
+#endif
@@ -3,22 +3,110 @@
 	Description:  PPP style or simply LZP.
 	Written by:   Gerald R. Tamayo, (8/22/2022)
 */
+#if defined( __linux__ )
+	#define _GNU_SOURCE   /* O_DIRECT, see gtdirect.c */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>   /* offsetof */
 #include <stdint.h>   /* C99 */
 #include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
 #include "gtbitio3.c"
+#include "gtcrc.c"
+#include "gtfilter.c"
+#include "gtlz.c"
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+	#include <pthread.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/resource.h>
+	#include <poll.h>
+	#define PPP_THREADS
+	#define PPP_MMAP
+#endif
+
+#if defined( __SSE2__ )
+	#include <emmintrin.h>
+#endif
+
+#if defined( _WIN32 )
+	#include <direct.h>
+	#include <io.h>
+	#include <fcntl.h>
+	#define make_dir(d) _mkdir(d)
+#else
+	#define make_dir(d) mkdir(d, 0755)
+#endif
 
 /* PPP_BLOCKBITS must be >= 3 (multiple of 8 bytes blocksize) */
 #define PPP_BLOCKBITS  20
-#define PPP_BLOCKSIZE  (1<<PPP_BLOCKBITS)
+#define PPP_BLOCKSIZE  (1<<PPP_BLOCKBITS)   /* default and largest block size. */
+#define PPP_MINBLOCKBITS  12
+
+/* Table sizes: 2^15 .. 2^PPP_MAXWBITS bytes; the context hash and the
+	indexes are 64-bit. Tables of PPP_LAZYTABLE bytes or more are
+	anonymous mappings, faulted in as the hash reaches them and dropped
+	(not cleared) on a reset.
+*/
+#define PPP_MAXWBITS   40
+#define PPP_LAZYTABLE  ((int64_t) 1 << 25)
+
+/* --max-mem: the I/O buffers get 1/PPP_MEMIO of the budget (64 KB..1 MB),
+	the block buffers at most 1/PPP_MEMBLOCK; PPP_MEMBASE is for the
+	program itself (code, stdio, stacks).
+*/
+#define PPP_MEMIO     32
+#define PPP_MEMBLOCK  8
+#define PPP_MEMBASE   (4<<20)
+
+/* A generation-tagged table (batch, archives with --reset): a line of
+	2^TAG_BITS table bytes whose tag is not ppp_epoch reads as zeros, so
+	a reset is ppp_epoch++ instead of clearing the whole table.
+*/
+#define TAG_BITS  6
+
+/* estimate: EST_SAMPLE bytes in EST_CHUNK pieces from across the file,
+	coded with each table size in est_wbits[] and both hashes.
+*/
+#define EST_SAMPLE  (16<<20)
+#define EST_CHUNK   (1<<20)
+
+/* context hash policies */
+#define HASH_ADD  0   /* (prev<<5)+c, lzpgt7 */
+#define HASH_XOR  1   /* (prev<<4)^c, ppp3 */
+#define HASH_ADD6 2   /* (prev<<6)+c, shorter context; --models only */
+#define HASH_XOR3 3   /* (prev<<3)^c, longer context; --models only */
+#define PPP_HASH( prev, c, h )  ((h) == HASH_XOR ? (((prev)<<4)^(c)) : \
+	(h) == HASH_ADD6 ? (((prev)<<6)+(c)) : (h) == HASH_XOR3 ? (((prev)<<3)^(c)) : (((prev)<<5)+(c)))
+
+/* the block coders are instantiated per hash policy. */
+#if defined( __GNUC__ )
+	#define PPP_INLINE  static inline __attribute__(( always_inline ))
+#else
+	#define PPP_INLINE  static inline
+#endif
 
 enum {
 	/* modes */
 	COMPRESS,
 	DECOMPRESS,
+	ARCHIVE,
+	EXTRACT,
+	LIST,
+	TEST,
+	TRAIN,
+	ESTIMATE,
+	BATCH,
+	UNBATCH,
 };
 
 typedef struct {
@@ -28,21 +116,451 @@ typedef struct {
 	int ppp_WBITS;
 } file_stamp;
 
+/* "LZPGT8": an LZPGT7 stamp followed by file_stamp_ext. */
+typedef struct {
+	int ppp_flags;
+	int ppp_restart;   /* table reset every ppp_restart blocks. */
+	uint32_t ppp_crc;  /* stream hash: crc32c of the block checksums. */
+	uint32_t ppp_dict_id;  /* initial table from this dictionary. */
+	uint32_t ppp_ref_crc;  /* crc32c of the reference file. */
+	int ppp_blockbits;     /* block size. */
+	int64_t ppp_ref_size;  /* size of the reference file. */
+} file_stamp_ext;
+
+/* Older formats, decoded by the same coder: the block layout is the
+	same, only the block size, the table size (no ppp_WBITS in the
+	LZPGT and LZPGT6 stamps; 0 = from the stamp) and the hash differ.
+*/
+typedef struct {
+	const char *alg;
+	int blockbits;
+	int wbits;
+	int hash;
+} legacy_format;
+
+static const legacy_format legacy_formats[] = {
+	{ "LZPGT",  15, 20, HASH_ADD },
+	{ "LZPGT2", 15,  0, HASH_ADD },
+	{ "LZPGT6", 20, 21, HASH_ADD },
+	{ "PPP3",   20,  0, HASH_XOR },
+	{ NULL, 0, 0, 0 }
+};
+
+/* ppp_flags */
+#define PPP_RESTART   1   /* restart points and a trailing seek table. */
+#define PPP_CHECKSUM  2   /* crc32c (LE) of each block after its coded bytes. */
+#define PPP_DICT      4   /* the table starts from a trained dictionary. */
+#define PPP_REF       8   /* the table is primed with a reference file (delta). */
+#define PPP_HASHXOR  16   /* HASH_XOR context hash. */
+#define PPP_STREAM   32   /* streamed: sized blocks, an end marker and a trailer. */
+#define PPP_STORED   64   /* a block type byte before each block. */
+#define PPP_DEDUP   128   /* the blocks code a dedup record stream. */
+#define PPP_FILTER  256   /* a filter id byte (gtfilter.h) before each block. */
+#define PPP_LZ      512   /* literals: a byte 0 (raw) or 1, 32-bit LE size, gtlz data. */
+#define PPP_MODELS 1024   /* a model id byte before each coded block. */
+#define PPP_WORD2  2048   /* predict 16-, 32- or 64-bit words, not bytes. */
+#define PPP_WORD4  4096
+#define PPP_WORD8  8192
+#define PPP_WORDS  (PPP_WORD2|PPP_WORD4|PPP_WORD8)
+#define PPP_STRIDE 16384  /* record stride context; a u32 stride follows. */
+#define PPP_FRAMES 32768  /* PPP_STREAM: any block may be short (--follow frames). */
+#define PPP_SIZED  65536  /* a frame: its size follows (i64 LE); frames concatenate. */
+#define PPP_WORDSIZE( f ) \
+	(((f) & PPP_WORD2) ? 2 : ((f) & PPP_WORD4) ? 4 : ((f) & PPP_WORD8) ? 8 : 0)
+
+/* --models: the block models. Each has its own table and context
+	and learns every block; a block is coded with the one that predicts
+	it best. The ids are stored in files, never renumber them.
+*/
+#define PPP_NMODELS  4
+
+typedef struct {
+	const char *name;
+	int hash;
+} ppp_model;
+
+static const ppp_model ppp_models[ PPP_NMODELS ] = {
+	{ "add5", HASH_ADD  },   /* lzpgt7 */
+	{ "xor4", HASH_XOR  },   /* ppp3 */
+	{ "add6", HASH_ADD6 },   /* short context: records, binary */
+	{ "xor3", HASH_XOR3 },   /* long context: logs, repeats */
+};
+
+typedef struct {
+	unsigned char *w;      /* the model's table; model 0 has win_buf. */
+	unsigned char *flags, *lits;   /* its trial coding of the block. */
+	int nlits;
+	int64_t prev;
+} model_trial;
+
+enum { MODEL_TRIAL, MODEL_UPDATE, MODEL_QUIT };
+
+/* PPP_MODELS: a byte after the file stamp, the number of models. */
+static struct {
+	int n;   /* models */
+	model_trial t[ PPP_NMODELS ];
+	unsigned char *p;   /* the block */
+	int len, win, phase;
+	int64_t count[ PPP_NMODELS ];   /* blocks coded per model */
+#if defined( PPP_THREADS )
+	int nthreads, gen, ndone;
+	pthread_t th[ PPP_NMODELS ];
+	pthread_mutex_t lock;
+	pthread_cond_t go, done;
+#endif
+} mdl;
+
+#define FILTER_AUTO     (-1)   /* --filter auto: the best of a sample, per block. */
+#define FILTER_SAMPLE   (1<<16)
+
+#define STRIDE_AUTO     (-1)      /* --stride auto, see detect_stride(). */
+#define STRIDE_AUTOMAX  4096
+#define STRIDE_SAMPLE   (1<<18)
+#define STRIDE_MAX      (1<<16)   /* the phase takes 16 bits of the context. */
+
+/* Block types (PPP_STORED). A stored block is the raw bytes; the
+	tables learn it as if it were coded, so the next block is predicted
+	the same either way. A raw block is the bytes too, passed through:
+	the tables learn only its first STORE_SAMPLE bytes and the contexts
+	take in its last ones.
+	The encoder runs the model over STORE_SAMPLE bytes (words with
+	PPP_WORDS) of a block, see store_sample(), and undoes its writes.
+	With hits under half what the flags cost (1/16, or 1/(16*ws) for
+	words of ws bytes) the block is raw; from 1/4 the plain model codes
+	it straight; in between, or with PPP_LZ (literals may still pack),
+	it is coded in trial and stored when that is not smaller. After
+	STORE_RETRY raw blocks in a row, or a table reset, the next block
+	is coded in trial whatever its sample, so a table left cold by
+	noise warms when the data changes.
+	A run block is one byte value repeated, e.g. zeros in a disk image
+	(a hole in a sparse input), coded as the value alone; it leaves
+	the table untouched and only advances the context hash.
+	A block with runs of RUN_MINLEN or more inside is split: the runs
+	become run parts and the bytes between them parts of their own,
+	each its length (32-bit LE) and then typed as a block; a part is
+	never split again.
+*/
+#define BLOCK_CODED   0
+#define BLOCK_STORED  1
+#define BLOCK_RUN     2
+#define BLOCK_SPLIT   3
+#define BLOCK_RAW     4
+#define RUN_MINLEN    1024
+#define STORE_SAMPLE  4096
+#define STORE_PIECES  4
+#define STORE_RETRY   8
+
+/* Stream format (PPP_STREAM): the output is never rewound, so the
+	stamp has ppp_nblocks = -1. Each block is preceded by its
+	uncompressed size (32-bit LE); a size of 0 ends the stream and is
+	followed by the stream_trailer. With PPP_FRAMES blocks may be
+	short anywhere; the trailer then counts the bytes as if all the
+	blocks but the last were full.
+*/
+typedef struct {
+	int64_t ppp_nblocks;
+	int ppp_lastblocksize;
+	uint32_t ppp_crc;
+} stream_trailer;
+
+/* Dedup (PPP_DEDUP): the input is cut into content-defined chunks
+	(gear rolling hash, DD_MINCHUNK..DD_MAXCHUNK, about DD_AVGBITS on
+	average) and the coder is given a record stream instead:
+	
+		'L' len (32-bit LE) then len bytes: new data
+		'R' len (32-bit LE) offset (64-bit LE): a copy of len bytes from
+		    an earlier offset of the output, a chunk seen before
+	
+	Chunks are identified by a 64-bit mixing hash plus crc32c.
+*/
+#define DD_MINCHUNK  (1<<11)
+#define DD_AVGBITS   13
+#define DD_MAXCHUNK  (1<<16)
+#define DD_MAXLIT    (1<<20)   /* new chunks are merged into 'L' records up to this. */
+
+/* Dictionary file: dict_stamp padded to DICT_HDRSIZE, then the primed
+	table (1<<ppp_WBITS bytes), page aligned so it can be mapped.
+*/
+#define DICT_HDRSIZE  4096
+
+typedef struct {
+	char alg[8];
+	uint32_t dict_id;   /* crc32c of the table. */
+	int ppp_WBITS;
+	int ppp_hash;
+} dict_stamp;
+
+/* Seek table: one seek_entry per restart point, then the seek_footer
+	as the last bytes of the file.
+*/
+typedef struct {
+	int64_t uoffset;   /* uncompressed offset of the restart block. */
+	int64_t coffset;   /* its offset in the compressed file. */
+} seek_entry;
+
+typedef struct {
+	int64_t nentries;
+	int64_t table_offset;
+	char magic[8];
+} seek_footer;
+
+/* Checkpoint file (outfile.ckpt): ckpt_stamp, the seek entries, the
+	record history (PPP_STRIDE), then the table in CKPT_CHUNK pieces,
+	each a u32 LE size and gtlz data (the high bit set: stored raw).
+	It is taken at a block end, where the output is byte aligned.
+	The state kept for --append (done = 1) is taken before the last
+	block when that is short, and its bytes (tail_n) follow: the next
+	run codes them again, ahead of the new data.
+*/
+#define CKPT_CHUNK  (1<<20)
+#define CKPT_RAW    0x80000000u
+#define CKPT_HDRMAX 80
+
+typedef struct {
+	char magic[8];
+	int64_t in_offset;    /* input coded, a block boundary. */
+	int64_t out_size;     /* output written by then. */
+	int64_t nblocks;
+	int64_t prev;         /* ppp_prev */
+	int64_t seek_n;
+	int64_t filter_count[ FILTER_MAX+1 ];
+	uint32_t crc;         /* ppp_crc */
+	uint32_t last_crc;    /* crc32c of the last block: the same input? */
+	int last_n;
+	int phase;            /* ppp_phase */
+	int store_raw;        /* so the resumed run stores the same blocks. */
+	int wbits;            /* not in the header until it is rewritten. */
+	int done;             /* the run ended: a state to --append to. */
+	int tail_n;
+	int hdrsize;
+	unsigned char hdr[ CKPT_HDRMAX ];   /* the output header: the same options? */
+} ckpt_stamp;
+
+/* Archive: archive_stamp, the members' coded blocks, then the index
+	(one member_entry plus the name per member) at index_offset.
+*/
+typedef struct {
+	char alg[8];
+	int64_t nmembers;
+	int64_t index_offset;
+	int ppp_WBITS;
+	int solid;   /* 1 = one warm table for all members, 0 = reset per member. */
+} archive_stamp;
+
+typedef struct {
+	int64_t offset;   /* coded data offset in the archive. */
+	int64_t csize;
+	int64_t usize;
+	int namelen;
+	int reserved;
+} member_entry;
+
+typedef struct {
+	char *name;
+	member_entry e;
+} arc_member;
+
 unsigned char *win_buf;   /* the prediction buffer or "GuessTable". */
-unsigned char pattern[ PPP_BLOCKSIZE ];   /* the "look-ahead" buffer. */
-unsigned char cbuf[PPP_BLOCKSIZE];
+unsigned char *pattern = NULL;   /* the "look-ahead" buffer. */
+unsigned char *cbuf = NULL;
+unsigned char *gbits = NULL;     /* a block's flags, decoding. */
 int64_t ppp_nblocks;
 int ppp_lastblocksize;
-int ppp_WBITS, ppp_WSIZE, ppp_WMASK;
+int ppp_WBITS;
+int64_t ppp_WSIZE, ppp_WMASK;
+int ppp_blocksize = PPP_BLOCKSIZE;
+int ppp_hash = HASH_ADD;
+int64_t ppp_prev = 0; /* context hash, carried across blocks. */
+int store_raw = STORE_RETRY;   /* PPP_STORED: raw blocks in a row. */
+int ppp_discard = 0;  /* decode without writing (table state only). */
+int ppp_filter = FILTER_NONE;
+unsigned char *fbuf = NULL;    /* the filtered block. */
+unsigned char *lzbuf = NULL;   /* LZ coded literals. */
+int ppp_word = 0;   /* PPP_WORDS: the word size in bytes; 0: bytes. */
+int ppp_stride = 0;   /* PPP_STRIDE: the record size; 0: none. */
+int ppp_phase = 0;    /* the next byte's offset in its record. */
+unsigned char *rec_hist = NULL;   /* the last ppp_stride bytes. */
+uint16_t *ppp_tags = NULL;   /* generation tags per table line, or NULL. */
+uint16_t ppp_epoch = 1;
+int64_t ppp_maxmem = 0;   /* --max-mem budget; 0: none. */
+int64_t ppp_memneed = 0;  /* what the buffers and tables were sized to. */
+int64_t filter_count[ FILTER_MAX+1 ];
+int ppp_sparse = 0;   /* zero blocks are seeked over, not written. */
+int ppp_hole_end = 0; /* the output ends in a hole. */
+int ppp_sparse_in = 0; /* the input has holes (SEEK_DATA). */
+file_stamp_ext fext;
+int ppp_hdrsize;      /* file stamp size, offset of the first block. */
+seek_entry *seek_table = NULL;
+int64_t seek_n = 0, seek_max = 0, seek_end = 0;
+int ppp_errors = 0;   /* checksum/format errors found while decoding. */
+int ppp_eof_fill = 0; /* get buffer refills past the end of the input. */
+uint32_t ppp_crc = 0;
+int ppp_nthreads = 0;
+int64_t ppp_ckpt = 0;    /* --checkpoint interval; 0: none. */
+int64_t ppp_ckpt_next = 0;
+char *ckpt_name = NULL;   /* outfile.ckpt */
+ckpt_stamp ckpt;          /* the output header; where --resume starts. */
+int ppp_append = 0;       /* keep the final state in outfile.ckpt. */
+unsigned char *ppp_tail = NULL;   /* coded again before the input (--append). */
+int ppp_tail_n = 0;
+int ppp_flush_ms = 100;       /* --follow: a frame holds bytes this long at most, */
+int64_t ppp_flush_size = 0;   /* or this many; 0: a block. */
+volatile sig_atomic_t ppp_stop = 0;
+int64_t ppp_in_left = -1;     /* c --range: input still to code; -1: all. */
+unsigned char frame_hdr[ CKPT_HDRMAX ];   /* PPP_SIZED: the first frame's settings. */
+int64_t frame_off = 0, frame_size = 0;
+unsigned char *dict_map = NULL;   /* the dictionary table, read-only. */
+int dict_fd = -1;
+int win_buf_mapped = 0;
+unsigned char *ref_table = NULL;  /* the primed table, kept for restarts. */
+arc_member *members = NULL;   /* archive members, training samples. */
+int64_t nmembers = 0, max_members = 0;
+
+typedef struct {
+	uint64_t h;        /* 0: empty slot. */
+	uint32_t crc;
+	uint32_t len;
+	int64_t offset;    /* first occurrence in the input. */
+} dd_entry;
+
+struct {
+	/* encoder */
+	uint64_t gear[256];
+	unsigned char *in;     /* input window: [in_pos, in_end) not yet chunked. */
+	int in_pos, in_end, eof;
+	unsigned char *q;      /* record stream not yet given to the coder. */
+	int q_pos, q_end, lit_hdr;   /* lit_hdr: open 'L' record header at q[lit_hdr], or -1. */
+	dd_entry *tab;
+	int64_t tab_size, tab_n;
+	int64_t in_bytes, dup_bytes;
+	/* decoder */
+	unsigned char hdr[13];
+	int hdr_n, hdr_len;
+	uint32_t lit_left;
+	unsigned char *copy;
+} dd;
 
 void copyright( void );
+void   encode_block( unsigned char w[], unsigned char *p, int n );
+void   decode_block( unsigned char w[], unsigned char *out, int n );
+void   put_block( unsigned char *p, int n );
+void   init_table( unsigned char w[] );
+void   reset_table( unsigned char w[] );
+void   put_checksum( unsigned char *p, int n );
+void   check_block( unsigned char *p, int n, int64_t blockno );
+int    check_stream( void );
+int    test_parallel( char *infile );
+int    load_dict( char *dictname );
+void   free_dict( void );
+unsigned char *alloc_table( void );
+int    alloc_blocks( int encode );
+void   free_blocks( void );
+int    fit_memory( int mode, int wbits_given, int use_direct );
+int    estimate( char *infile, int64_t sample );
+double wall_secs( void );
+int    models_init( unsigned char w[], int encode );
+void   models_free( void );
+void   models_reset( void );
+int    trial_models( unsigned char *p, int n );
+int    detect_stride( char *infile );
+int    stride_init( void );
+void   stride_reset( int64_t blockno );
+int64_t parse_size( const char *s );
+void   report_memory( void );
+void   free_table( unsigned char w[] );
+int    dict_train( char *dictname, char *names[], int n );
+void   add_argument( const char *arg );
+int    prime_ref( unsigned char w[], char *refname, int64_t size, uint32_t crc );
+void   choose_level( int level, int64_t insize, int wbits_given, int hash_given );
+int    is_run( unsigned char *p, int n );
+void   put_literals( unsigned char *p, int n );
+int    pack_literals( unsigned char *p, int n );
+void   put_packed( unsigned char *p, int n, int k );
+void   gb_read( unsigned char *p, int n );
+int    read_block( unsigned char *p, int n );
+int    dedup_read( unsigned char *p, int n );
+void   dedup_put( unsigned char *p, int n );
+void   dedup_free( void );
+void   put_le32( uint32_t v );
+int    get_le32( uint32_t *v );
+void   put_trailer( void );
+int64_t decompress_stream( unsigned char w[], int64_t off, int64_t len );
+int64_t decompress_range( unsigned char w[], int64_t off, int64_t len );
+int    make_header( unsigned char *h, file_stamp *fs );
+void   frame_key( unsigned char *h, int n );
+int64_t decompress_frames( unsigned char w[] );
+int    cat_frames( char *outname, char *names[], int n );
 void   compress_LZP( unsigned char w[], unsigned char p[] );
+void   follow_LZP( unsigned char w[], unsigned char p[] );
+void   save_checkpoint( unsigned char w[], unsigned char *p, int n, int done );
+FILE  *open_checkpoint( ckpt_stamp *ck );
+int    resume_checkpoint( FILE *fp, ckpt_stamp *ck, unsigned char w[], unsigned char p[] );
 void decompress_LZP( unsigned char w[] );
+int  archive_options( const char *c_only );
+int  archive_create( char *arcname, char *names[], int n, int solid, int use_direct );
+int  archive_extract( char *arcname, char *names[], int n, int list_only, int use_direct );
+int  batch_files( char *outdir, char *names[], int n, int decode );
 
 void usage( void )
 {
-	fprintf(stderr, "\n Usage: lzpgt7 c[N]|d infile outfile\n"
-		"\n Commands:\n  c[N] = where N is Prediction Table bitsize (15..30) default=21. \n  d = decoding.\n"
+	fprintf(stderr, "\n Usage: lzpgt7 c[N]|d [options] infile outfile\n"
+		"        lzpgt7 a[N] [options] archive file|dir|@list ...\n"
+		"        lzpgt7 x|l [options] archive [member ...]\n"
+		"        lzpgt7 t [options] infile\n"
+		"        lzpgt7 train[N] dictfile sample|dir|@list ...\n"
+		"        lzpgt7 estimate [--sample N] [--threads N] infile\n"
+		"        lzpgt7 batch[N]|unbatch outdir file|dir|@list ...\n"
+		"        lzpgt7 cat outfile frame ...\n"
+		"\n Commands:\n  c[N] = where N is Prediction Table bitsize (15..40) default=21. \n  d = decoding; also reads LZPGT, LZPGT2, LZPGT6 and PPP3 files.\n"
+		"  a[N] = create archive (solid: one table for all members).\n"
+		"  x = extract all or the named members.\n  l = list archive members.\n"
+		"  t = test: decode and verify checksums, write nothing.\n"
+		"  train[N] = build a primed prediction table (dictionary) from samples.\n"
+		"  batch[N] = code many files, each to outdir/name.lzp, with one table;\n"
+		"             unbatch = decode them back (name.lzp -> outdir/name).\n"
+		"  estimate = predict ratio and speed per table size and hash from\n"
+		"             samples of the file (--sample N bytes, default 16M).\n"
+		"  cat = join frames (c --frame, --range) into one file; they are\n"
+		"             checked and copied, not coded again.\n"
+		"\n Options:\n  --direct = write output with O_DIRECT (bypass the page cache).\n"
+		"  --reset  = archive: reset the table per member (faster single extraction).\n"
+		"  --restart N = c: reset the table every N blocks and write a seek table.\n"
+		"  --range off:len = d: decode only len bytes from offset off;\n"
+		"             c: code only those bytes, as a frame.\n"
+		"  --frame = c: a self-contained frame: it can be joined to others\n"
+		"             with cat and d decodes the whole.\n"
+		"  --check = c: add per-block and whole-stream checksums (crc32c).\n"
+		"  --threads N = t: verify independent (--restart) blocks on N threads.\n"
+		"  --dict file = c|d|t: start from a trained dictionary.\n"
+		"  --ref file = c|d|t: delta mode, prime the table with a reference file.\n"
+		"  --stream = c: stream format (no header rewrite); implied by out = -.\n"
+		"  --store = c: store incompressible blocks raw and code runs of one\n"
+		"             byte (1 KB or more) by value (on with -1..-9).\n"
+		"  --sparse = d: write zero blocks as holes.\n"
+		"  --filter f = c: none, delta1|2|4|8, x86, planes2|4|8 or auto (per block).\n"
+		"  --lz = c: code each block's literals with a fast LZ77 (on with -7..-9).\n"
+		"  --word 2|4|8 = c: predict whole 16/32/64-bit words (UTF-16, int and\n"
+		"             float arrays): one flag per word.\n"
+		"  --stride N|auto = c: fixed-width records of N bytes: predict from the\n"
+		"             byte N back and the offset in the record; auto finds N.\n"
+		"  --models N = c: N (2..4) models (add5, xor4, add6, xor3), each with\n"
+		"             its own table; each block is coded with the best one.\n"
+		"  --dedup = c: replace repeated chunks with references (d needs a\n"
+		"             seekable output).\n"
+		"  -1 .. -9 = c: level; sizes the table, block and hash to the input and\n"
+		"             the caches (-1 fastest, table in L2; -9 largest table).\n"
+		"  --hash add|xor = c|train: context hash (prev<<5)+c or (prev<<4)^c.\n"
+		"  --max-mem N[K|M|G] = c|d|t: fit buffers and table in N bytes; c\n"
+		"             shrinks the block and table, d|t fail if the file can't fit.\n"
+		"  --checkpoint N[K|M|G] = c: every N input bytes save the table and\n"
+		"             coder state in outfile.ckpt.\n"
+		"  --resume = c: continue an interrupted run from outfile.ckpt; give\n"
+		"             the same options. The output is as if never stopped.\n"
+		"  --append = c: add infile to outfile, continuing its table (kept in\n"
+		"             outfile.ckpt); give the same options each time.\n"
+		"  --follow = c: code a growing file (tail -f) as a stream of frames\n"
+		"             until interrupted; a frame is written every\n"
+		"             --flush-ms N (100) or --flush-size N bytes of input.\n"
 	);
 	copyright();
 	exit(0);
@@ -53,88 +571,543 @@ int main( int argc, char *argv[] )
 	float ratio = 0.0;
 	int mode = -1;
 	file_stamp fstamp;
+	char *cmd = NULL, *infile = NULL, *outfile = NULL;
+	char **args, *dictname = NULL, *refname = NULL, *c_only = NULL;
+	int i, nargs = 0, use_direct = 0, solid = 1, level = 0, hash_given = 0, stream = 0, sparse = 0, word;
+	int resume = 0, follow = 0, frame = 0;
+	struct stat st;
+	int64_t range_off = 0, range_len = -1, sample = EST_SAMPLE;
+	ckpt_stamp ck;
+	FILE *ckpt_fp = NULL;
 	
 	clock_t start_time = clock();
 	
-	if ( argc != 4 ) usage();
-	init_buffer_sizes( (1<<20) );
+	memset( &fstamp, 0, sizeof(fstamp) );   /* all its bytes are written. */
+	
+	/* Process options; the rest are the command and file names. */
+	args = (char **) malloc( sizeof(char *) * argc );
+	if ( !args ) return 0;
+	for ( i = 1; i < argc; i++ ) {
+		if ( argv[i][0] == '-' && argv[i][1] == '-' ) {
+			if ( !strcmp( argv[i], "--direct" ) ) use_direct = 1;
+			else if ( !strcmp( argv[i], "--reset" ) ) solid = 0;
+			else if ( !strcmp( argv[i], "--restart" ) && i+1 < argc ) {
+				fext.ppp_restart = atoi( argv[++i] );
+				if ( fext.ppp_restart < 0 ) usage();
+				if ( fext.ppp_restart ) fext.ppp_flags |= PPP_RESTART;
+			}
+			else if ( !strcmp( argv[i], "--check" ) ) fext.ppp_flags |= PPP_CHECKSUM;
+			else if ( !strcmp( argv[i], "--stream" ) ) c_only = argv[i], stream = 1;
+			else if ( !strcmp( argv[i], "--store" ) ) fext.ppp_flags |= PPP_STORED;
+			else if ( !strcmp( argv[i], "--sparse" ) ) sparse = 1;
+			else if ( !strcmp( argv[i], "--dedup" ) ) fext.ppp_flags |= PPP_DEDUP;
+			else if ( !strcmp( argv[i], "--lz" ) ) fext.ppp_flags |= PPP_LZ;
+			else if ( !strcmp( argv[i], "--word" ) && i+1 < argc ) {
+				word = atoi( argv[++i] );
+				if ( word == 2 ) fext.ppp_flags |= PPP_WORD2;
+				else if ( word == 4 ) fext.ppp_flags |= PPP_WORD4;
+				else if ( word == 8 ) fext.ppp_flags |= PPP_WORD8;
+				else usage();
+			}
+			else if ( !strcmp( argv[i], "--stride" ) && i+1 < argc ) {
+				i++;
+				ppp_stride = !strcmp( argv[i], "auto" ) ? STRIDE_AUTO : atoi( argv[i] );
+				if ( ppp_stride != STRIDE_AUTO && (ppp_stride < 2 || ppp_stride > STRIDE_MAX) ) usage();
+				fext.ppp_flags |= PPP_STRIDE;
+			}
+			else if ( !strcmp( argv[i], "--models" ) && i+1 < argc ) {
+				mdl.n = atoi( argv[++i] );
+				if ( mdl.n < 2 || mdl.n > PPP_NMODELS ) usage();
+				fext.ppp_flags |= PPP_MODELS;
+			}
+			else if ( !strcmp( argv[i], "--filter" ) && i+1 < argc ) {
+				i++;
+				if ( !strcmp( argv[i], "auto" ) ) ppp_filter = FILTER_AUTO;
+				else if ( (ppp_filter = filter_id( argv[i] )) < 0 ) usage();
+				fext.ppp_flags |= PPP_FILTER;
+			}
+			else if ( !strcmp( argv[i], "--dict" ) && i+1 < argc ) c_only = argv[i], dictname = argv[++i];
+			else if ( !strcmp( argv[i], "--ref" ) && i+1 < argc ) c_only = argv[i], refname = argv[++i];
+			else if ( !strcmp( argv[i], "--hash" ) && i+1 < argc ) {
+				i++;
+				if ( !strcmp( argv[i], "add" ) ) ppp_hash = HASH_ADD;
+				else if ( !strcmp( argv[i], "xor" ) ) ppp_hash = HASH_XOR;
+				else usage();
+				hash_given = 1;
+			}
+			else if ( !strcmp( argv[i], "--max-mem" ) && i+1 < argc ) {
+				c_only = argv[i];
+				if ( (ppp_maxmem = parse_size( argv[++i] )) <= 0 ) usage();
+			}
+			else if ( !strcmp( argv[i], "--checkpoint" ) && i+1 < argc ) {
+				c_only = argv[i];
+				if ( (ppp_ckpt = parse_size( argv[++i] )) <= 0 ) usage();
+			}
+			else if ( !strcmp( argv[i], "--resume" ) ) c_only = argv[i], resume = 1;
+			else if ( !strcmp( argv[i], "--append" ) ) c_only = argv[i], ppp_append = 1;
+			else if ( !strcmp( argv[i], "--follow" ) ) c_only = argv[i], follow = 1;
+			else if ( !strcmp( argv[i], "--frame" ) ) c_only = argv[i], frame = 1;
+			else if ( !strcmp( argv[i], "--flush-ms" ) && i+1 < argc ) {
+				if ( (ppp_flush_ms = atoi( argv[++i] )) < 0 ) usage();
+			}
+			else if ( !strcmp( argv[i], "--flush-size" ) && i+1 < argc ) {
+				if ( (ppp_flush_size = parse_size( argv[++i] )) <= 0 ) usage();
+			}
+			else if ( !strcmp( argv[i], "--sample" ) && i+1 < argc ) {
+				if ( (sample = parse_size( argv[++i] )) <= 0 ) usage();
+			}
+			else if ( !strcmp( argv[i], "--threads" ) && i+1 < argc ) {
+				ppp_nthreads = atoi( argv[++i] );
+			}
+			else if ( !strcmp( argv[i], "--range" ) && i+1 < argc ) {
+				c_only = argv[i];
+				if ( sscanf( argv[++i], "%lld:%lld", (long long *) &range_off,
+					(long long *) &range_len ) != 2 || range_off < 0 || range_len < 0 ) usage();
+			}
+			else usage();
+		}
+		else if ( argv[i][0] == '-' && isdigit( (unsigned char) argv[i][1] ) && !argv[i][2] ) {
+			level = argv[i][1] - '0';
+			if ( level == 0 ) usage();
+			fext.ppp_flags |= PPP_STORED;
+		}
+		else args[nargs++] = argv[i];
+	}
+	if ( nargs < 2 ) usage();
+	cmd = args[0];
+	infile = args[1];
+	if ( ppp_maxmem ) {
+		int64_t io = ppp_maxmem / PPP_MEMIO;
+		init_buffer_sizes( io < (1<<16) ? (1<<16) : io > (1<<20) ? (1<<20) : (unsigned int) io );
+	}
+	else init_buffer_sizes( (1<<20) );
+	crc32c_init();
+	
+	if ( !strcmp( cmd, "estimate" ) ) {
+		if ( nargs != 2 ) usage();
+		i = estimate( infile, sample );
+		fprintf(stderr, " in %3.2f secs.\n", (double) (clock()-start_time) / CLOCKS_PER_SEC );
+		free( args );
+		return i ? 0 : 1;
+	}
+	if ( !strcmp( cmd, "cat" ) ) {
+		if ( nargs < 3 ) usage();
+		i = cat_frames( infile, &args[2], nargs-2 );
+		fprintf(stderr, " in %3.2f secs.\n", (double) (clock()-start_time) / CLOCKS_PER_SEC );
+		free( args );
+		return i ? 0 : 1;
+	}
 	
-	/* Process options, get ppp_WBITS. */
-	if ( tolower(argv[1][0]) == 'c' ) {
-		mode = COMPRESS;
-		if ( argv[1][1] == '\0' ) ppp_WBITS = 21;  /* default 2MB table size */
-		else ppp_WBITS = atoi(&argv[1][1]);
-		if ( argv[1][1] == '0' || ppp_WBITS == 0 ) usage();
+	/* Process command, get ppp_WBITS. */
+	if ( !strncmp( cmd, "train", 5 ) ) {
+		mode = TRAIN;
+		cmd += 4;
+	}
+	else if ( !strncmp( cmd, "batch", 5 ) ) {
+		mode = BATCH;
+		cmd += 4;
+	}
+	else if ( !strcmp( cmd, "unbatch" ) ) mode = UNBATCH;
+	if ( mode == UNBATCH ) ;
+	else if ( mode == TRAIN || mode == BATCH || tolower(cmd[0]) == 'c' || tolower(cmd[0]) == 'a' ) {
+		if ( mode != TRAIN && mode != BATCH ) mode = tolower(cmd[0]) == 'c' ? COMPRESS : ARCHIVE;
+		if ( cmd[1] == '\0' ) ppp_WBITS = 21;  /* default 2MB table size */
+		else ppp_WBITS = atoi(&cmd[1]);
+		if ( cmd[1] == '0' || ppp_WBITS == 0 ) usage();
 		if ( ppp_WBITS < 15 ) ppp_WBITS = 15;
-		else if ( ppp_WBITS > 30 ) ppp_WBITS = 30;
+		else if ( ppp_WBITS > PPP_MAXWBITS ) ppp_WBITS = PPP_MAXWBITS;
 	}
-	else if ( tolower(argv[1][0]) == 'd' ) {
-		mode = DECOMPRESS;
-		if ( argv[1][1] != '\0' ) usage();
+	else if ( tolower(cmd[0]) == 'd' || tolower(cmd[0]) == 't' ) {
+		mode = tolower(cmd[0]) == 'd' ? DECOMPRESS : TEST;
+		if ( cmd[1] != '\0' ) usage();
+	}
+	else if ( tolower(cmd[0]) == 'x' || tolower(cmd[0]) == 'l' ) {
+		mode = tolower(cmd[0]) == 'x' ? EXTRACT : LIST;
+		if ( cmd[1] != '\0' ) usage();
 	}
 	else usage();
-
-	if ( (gIN=fopen( argv[2], "rb" )) == NULL ) {
+	
+	/* archive modes: many files in, many files out. */
+	if ( (mode == ARCHIVE || mode == EXTRACT || mode == TRAIN || mode == BATCH || mode == UNBATCH)
+		&& !alloc_blocks( mode != EXTRACT && mode != UNBATCH ) ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		return 0;
+	}
+	if ( mode == ARCHIVE ) {
+		if ( nargs < 3 ) usage();
+		if ( level ) fprintf(stderr, "\n archive: levels are for c; give the table size as aN.");
+		i = !level && archive_options( c_only ) && archive_create( infile, &args[2], nargs-2, solid, use_direct );
+	}
+	if ( mode == EXTRACT || mode == LIST ) {
+		archive_extract( infile, &args[2], nargs-2, mode == LIST, use_direct );
+	}
+	if ( mode == TRAIN ) {
+		if ( nargs < 3 ) usage();
+		dict_train( infile, &args[2], nargs-2 );
+	}
+	if ( mode == BATCH || mode == UNBATCH ) {
+		if ( nargs < 3 ) usage();
+		batch_files( infile, &args[2], nargs-2, mode == UNBATCH );
+	}
+	if ( mode != COMPRESS && mode != DECOMPRESS && mode != TEST ) {
+		fprintf(stderr, " in %3.2f secs.\n", (double) (clock()-start_time) / CLOCKS_PER_SEC );
+		free_blocks();
+		free( args );
+		return (mode == ARCHIVE && !i) ? 1 : 0;
+	}
+	if ( nargs != (mode == TEST ? 2 : 3) ) usage();
+	outfile = (mode == TEST) ? NULL : args[2];
+	
+	/* "-" is stdin or stdout; a pipe can't be rewound, so stream. */
+	if ( outfile && !strcmp( outfile, "-" ) ) {
+		if ( mode == COMPRESS ) stream = 1;
+		use_direct = 0;
+	}
+#if defined( _WIN32 )
+	_setmode( _fileno( stdin ), _O_BINARY );
+	_setmode( _fileno( stdout ), _O_BINARY );
+#endif
+	if ( (fext.ppp_flags & PPP_WORDS) && (fext.ppp_flags & PPP_MODELS) ) {
+		fprintf(stderr, "\n--word and --models don't combine.");
+		return 0;
+	}
+	if ( (fext.ppp_flags & PPP_STRIDE) && (fext.ppp_flags & (PPP_WORDS|PPP_MODELS)) ) {
+		fprintf(stderr, "\n--stride doesn't combine with --word or --models.");
+		return 0;
+	}
+	if ( follow ) {
+#if defined( PPP_THREADS )
+		if ( mode != COMPRESS || (fext.ppp_flags & PPP_DEDUP) ) {
+			fprintf(stderr, "\n--follow is for c, without --dedup.");
+			return 0;
+		}
+		stream = 1;
+		fext.ppp_flags |= PPP_FRAMES;
+#else
+		fprintf(stderr, "\n--follow is not supported on this system.");
+		return 0;
+#endif
+	}
+	if ( mode == COMPRESS && (frame || range_len >= 0) ) {
+		if ( stream || (fext.ppp_flags & PPP_DEDUP) || ppp_ckpt || resume || ppp_append
+			|| (range_len >= 0 && !strcmp( infile, "-" )) ) {
+			fprintf(stderr, "\nFrames need files and a seekable output (no --stream, --dedup,"
+				" --checkpoint, --resume or --append).");
+			return 0;
+		}
+		fext.ppp_flags |= PPP_SIZED;
+	}
+	if ( mode == COMPRESS && stream && (fext.ppp_flags & PPP_RESTART) ) {
+		fprintf(stderr, "\nRestart points need a seekable output (no --stream).");
+		return 0;
+	}
+	if ( (ppp_ckpt || resume || ppp_append) && (mode != COMPRESS || stream || use_direct
+		|| (!ppp_append && !strcmp( infile, "-" )) || (fext.ppp_flags & (PPP_DEDUP|PPP_MODELS))) ) {
+		fprintf(stderr, "\n--checkpoint, --resume and --append are for c with files (no --stream,"
+			" --direct, --dedup or --models).");
+		return 0;
+	}
+	if ( ppp_append && (ppp_ckpt || resume) ) {
+		fprintf(stderr, "\n--append doesn't combine with --checkpoint or --resume.");
+		return 0;
+	}
+	if ( ppp_ckpt || resume || ppp_append ) {
+		ckpt_name = (char *) malloc( strlen( outfile ) + 6 );
+		if ( !ckpt_name ) return 0;
+		sprintf( ckpt_name, "%s.ckpt", outfile );
+		/* a first --append creates the file. */
+		if ( ppp_append && stat( ckpt_name, &st ) && stat( outfile, &st ) == 0 ) {
+			fprintf(stderr, "\n %s has no %s to append to.", outfile, ckpt_name );
+			return 0;
+		}
+		if ( (resume || (ppp_append && stat( ckpt_name, &st ) == 0))
+			&& !(ckpt_fp = open_checkpoint( &ck )) ) return 0;
+		if ( ckpt_fp && ck.done != ppp_append ) {
+			fprintf(stderr, ck.done ? "\n %s: the run was complete; --append to it."
+				: "\n %s: an interrupted run; --resume it first.", ckpt_name );
+			fclose( ckpt_fp );
+			return 0;
+		}
+	}
+	if ( !strcmp( infile, "-" ) ) gIN = stdin;
+	else if ( (gIN=fopen( infile, "rb" )) == NULL ) {
 		fprintf(stderr, "\nError opening input file.");
 		return 0;
 	}
-	if ( (pOUT=fopen( argv[3], "wb" )) == NULL ) {
+	if ( mode == COMPRESS && range_len >= 0 ) {
+		if ( gt_fseek( gIN, range_off, SEEK_SET ) ) {
+			fprintf(stderr, "\nError seeking the input file.");
+			return 0;
+		}
+		ppp_in_left = range_len;
+	}
+	if ( outfile && !(ckpt_fp ? reopen_put_file( outfile, ck.out_size )
+		: open_put_file( outfile, use_direct )) ) {
 		fprintf(stderr, "\nError opening output file.");
 		return 0;
 	}
 	init_put_buffer();
+	if ( mode == DECOMPRESS && sparse && strcmp( outfile, "-" ) && !pOUT_direct ) ppp_sparse = 1;
+#if defined( SEEK_DATA ) && !defined( _WIN32 )
+	/* fewer blocks allocated than the size: the input has holes. */
+	if ( mode == COMPRESS && gIN != stdin && fstat( fileno( gIN ), &st ) == 0
+		&& S_ISREG( st.st_mode ) ) ppp_sparse_in = (int64_t) st.st_blocks * 512 < (int64_t) st.st_size;
+#endif
 	
+	ppp_hdrsize = sizeof(file_stamp);
+	if ( mode == COMPRESS && dictname ) {
+		if ( !load_dict( dictname ) ) goto halt_prog;
+		fext.ppp_flags |= PPP_DICT;
+	}
+	if ( mode == COMPRESS && refname ) fext.ppp_flags |= PPP_REF;
+	if ( mode == COMPRESS && level ) {
+		choose_level( level, range_len >= 0 ? range_len :
+			stat( infile, &st ) == 0 && S_ISREG( st.st_mode ) ? (int64_t) st.st_size : -1,
+			cmd[1] != '\0' || dictname, hash_given || dictname );
+	}
+	if ( mode == COMPRESS && ppp_maxmem && !fit_memory( mode, cmd[1] != '\0' || dictname, use_direct ) )
+		goto halt_prog;
+	if ( mode == COMPRESS && ppp_stride == STRIDE_AUTO && !(ppp_stride = detect_stride( infile )) )
+		fext.ppp_flags &= ~PPP_STRIDE;
 	if ( mode == COMPRESS ){
-		/* Write the FILE STAMP. */
-		strcpy( fstamp.alg, "LZPGT7" );
-		fwrite( &fstamp, sizeof(file_stamp), 1, pOUT );
-		nbytes_out = sizeof(file_stamp);
+		if ( ppp_hash == HASH_XOR ) fext.ppp_flags |= PPP_HASHXOR;
+		ppp_word = PPP_WORDSIZE( fext.ppp_flags );
+		if ( !(fext.ppp_flags & PPP_STRIDE) ) ppp_stride = 0;
+		if ( stream ) {
+			fext.ppp_flags |= PPP_STREAM;
+			fstamp.ppp_nblocks = -1;
+			fstamp.ppp_WBITS = ppp_WBITS;
+		}
+		/* Write the FILE STAMP; extensions need the LZPGT8 stamp. The
+			header is made in ckpt.hdr: a resumed run only checks it.
+		*/
+		fext.ppp_blockbits = 0;
+		while ( (1 << fext.ppp_blockbits) < ppp_blocksize ) fext.ppp_blockbits++;
+		strcpy( fstamp.alg, (fext.ppp_flags || ppp_blocksize != PPP_BLOCKSIZE) ? "LZPGT8" : "LZPGT7" );
+		ckpt.hdrsize = ppp_hdrsize = make_header( ckpt.hdr, &fstamp );
+		if ( !ckpt_fp ) pfwrite( ckpt.hdr, ppp_hdrsize );
+		nbytes_out = ppp_hdrsize;
 	}
-	else if ( mode == DECOMPRESS ){
+	else {
 		/* Read the file stamp. */
 		fread( &fstamp, sizeof(file_stamp), 1, gIN );
 		ppp_lastblocksize = fstamp.ppp_lastblocksize;
 		ppp_nblocks = fstamp.ppp_nblocks;
 		ppp_WBITS = fstamp.ppp_WBITS;
+		if ( !strcmp( fstamp.alg, "LZPGT8" ) ) {
+			fread( &fext, sizeof(file_stamp_ext), 1, gIN );
+			ppp_hdrsize += sizeof(file_stamp_ext);
+			if ( fext.ppp_blockbits < PPP_MINBLOCKBITS || fext.ppp_blockbits > PPP_BLOCKBITS ) {
+				fprintf(stderr, "\n %s: unsupported block size.", infile );
+				goto halt_prog;
+			}
+			ppp_blocksize = 1 << fext.ppp_blockbits;
+			ppp_hash = (fext.ppp_flags & PPP_HASHXOR) ? HASH_XOR : HASH_ADD;
+			ppp_word = PPP_WORDSIZE( fext.ppp_flags );
+			if ( fext.ppp_flags & PPP_MODELS ) {
+				mdl.n = fgetc( gIN );
+				ppp_hdrsize++;
+				if ( mdl.n < 1 || mdl.n > PPP_NMODELS ) {
+					fprintf(stderr, "\n %s: bad model count.", infile );
+					goto halt_prog;
+				}
+			}
+			if ( fext.ppp_flags & PPP_STRIDE ) {
+				for ( i = 0, ppp_stride = 0; i < 4; i++ ) ppp_stride |= (fgetc( gIN ) & 0xff) << (8*i);
+				ppp_hdrsize += 4;
+				if ( ppp_stride < 2 || ppp_stride > STRIDE_MAX ) {
+					fprintf(stderr, "\n %s: bad record stride.", infile );
+					goto halt_prog;
+				}
+			}
+			if ( fext.ppp_flags & PPP_SIZED ) {
+				for ( i = 0; i < 8; i++ ) frame_size |= (int64_t) (fgetc( gIN ) & 0xff) << (8*i);
+				ppp_hdrsize += 8;
+				frame_key( frame_hdr, make_header( frame_hdr, &fstamp ) );
+			}
+		}
+		else if ( strcmp( fstamp.alg, "LZPGT7" ) ) {
+			for ( i = 0; legacy_formats[i].alg && strcmp( fstamp.alg, legacy_formats[i].alg ); i++ ) ;
+			if ( !legacy_formats[i].alg || mode == COMPRESS ) {
+				fprintf(stderr, "\n %s: not an lzpgt file.", infile );
+				goto halt_prog;
+			}
+			ppp_blocksize = 1 << legacy_formats[i].blockbits;
+			if ( legacy_formats[i].wbits ) ppp_WBITS = legacy_formats[i].wbits;
+			ppp_hash = legacy_formats[i].hash;
+		}
+		if ( fext.ppp_flags & PPP_DICT ) {
+			uint32_t id = fext.ppp_dict_id;
+			if ( !dictname ) {
+				fprintf(stderr, "\n %s needs dictionary %08x (--dict).", infile, (unsigned) id );
+				goto halt_prog;
+			}
+			if ( !load_dict( dictname ) ) goto halt_prog;
+			if ( fext.ppp_dict_id != id || ppp_WBITS != fstamp.ppp_WBITS ) {
+				fprintf(stderr, "\n wrong dictionary: %s needs %08x.", infile, (unsigned) id );
+				goto halt_prog;
+			}
+		}
+		if ( ppp_WBITS < 1 || ppp_WBITS > PPP_MAXWBITS ) {
+			fprintf(stderr, "\n %s: unsupported table size.", infile );
+			goto halt_prog;
+		}
+		if ( (fext.ppp_flags & PPP_STREAM) == 0 && ppp_nblocks < 0 ) {
+			fprintf(stderr, "\n %s: bad file stamp.", infile );
+			goto halt_prog;
+		}
+		if ( (fext.ppp_flags & PPP_REF) && !refname ) {
+			fprintf(stderr, "\n %s is a delta: needs its reference file (--ref).", infile );
+			goto halt_prog;
+		}
+		if ( ppp_maxmem && !fit_memory( mode, 1, use_direct ) ) goto halt_prog;
 	}
-	ppp_WSIZE = 1 << ppp_WBITS;
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
 	ppp_WMASK = (ppp_WSIZE-1);
+	if ( !alloc_blocks( mode == COMPRESS ) ) {
+		fprintf(stderr, "\n Error alloc: block buffers.");
+		goto halt_prog;
+	}
 	
 	/* allocate memory for win_buf. */
-	win_buf = (unsigned char *) malloc( sizeof(unsigned char) * ppp_WSIZE );
+	win_buf = alloc_table();
 	if ( !win_buf ) {
 		fprintf(stderr, "\n Error alloc: Prediction Table (win_buf).");
 		goto halt_prog;
 	}
-	/* initialize prediction buffer to all zero (0) values. */
-	memset( win_buf, 0, ppp_WSIZE );
+	if ( (fext.ppp_flags & PPP_REF) && !prime_ref( win_buf, refname,
+		mode == COMPRESS ? -1 : fext.ppp_ref_size, fext.ppp_ref_crc ) ) goto halt_prog;
+	if ( (fext.ppp_flags & PPP_MODELS) && !models_init( win_buf, mode == COMPRESS ) ) {
+		fprintf(stderr, "\n Error alloc: block models.");
+		goto halt_prog;
+	}
+	if ( ppp_stride && !stride_init() ) {
+		fprintf(stderr, "\n Error alloc: record history.");
+		goto halt_prog;
+	}
+	ppp_ckpt_next = ppp_ckpt;
+	if ( ckpt_fp ) {
+		i = resume_checkpoint( ckpt_fp, &ck, win_buf, pattern );
+		fclose( ckpt_fp );
+		if ( !i ) goto halt_prog;
+		fprintf(stderr, ck.done ? "\n Appending at %lld bytes (block %lld)"
+			: "\n Resuming at %lld bytes (block %lld)", (long long) ck.in_offset, (long long) ck.nblocks );
+	}
 	
 	/* finally, compress or decompress */
 	if ( mode == COMPRESS ){
-		fprintf(stderr, "\n Prediction Table size used (%d bits)  = %u bytes", ppp_WBITS, (unsigned int) ppp_WSIZE );
-		fprintf(stderr, "\n\n Encoding [ %s to %s ] ...", argv[2], argv[3] );
-		compress_LZP( win_buf, pattern );
+		fprintf(stderr, "\n Prediction Table size used (%d bits)  = %lld bytes", ppp_WBITS, (long long) ppp_WSIZE );
+		if ( level ) fprintf(stderr, "\n Level %d: block size %d, %s hash", level, ppp_blocksize,
+			ppp_hash == HASH_XOR ? "xor" : "add" );
+		if ( dict_map ) fprintf(stderr, "\n Dictionary %s (%08x)", dictname, (unsigned) fext.ppp_dict_id );
+		if ( ppp_stride ) fprintf(stderr, "\n Record stride %d", ppp_stride );
+		fprintf(stderr, "\n\n Encoding [ %s to %s ] ...", infile, outfile );
+		if ( follow ) follow_LZP( win_buf, pattern );
+		else compress_LZP( win_buf, pattern );
+		if ( ppp_filter == FILTER_AUTO ) {
+			fprintf(stderr, "\n Filters:" );
+			for ( i = 0; i <= FILTER_MAX; i++ ) if ( filter_count[i] )
+				fprintf(stderr, " %s %lld", filter_name( i ), (long long) filter_count[i] );
+		}
+		if ( fext.ppp_flags & PPP_MODELS ) {
+			fprintf(stderr, "\n Models:" );
+			for ( i = 0; i < mdl.n; i++ )
+				fprintf(stderr, " %s %lld", ppp_models[i].name, (long long) mdl.count[i] );
+		}
+		if ( fext.ppp_flags & PPP_DEDUP ) {
+			fprintf(stderr, "\n Dedup: %lld of %lld bytes in repeated chunks.",
+				(long long) dd.dup_bytes, (long long) dd.in_bytes );
+			nbytes_read = dd.in_bytes;
+		}
+	}
+	else if ( mode == TEST ){
+		fprintf(stderr, "\n Testing %s ...", infile );
+		nbytes_out = fstamp.ppp_nblocks * ppp_blocksize + fstamp.ppp_lastblocksize;
+		if ( (fext.ppp_flags & (PPP_STREAM|PPP_SIZED|PPP_DEDUP)) || !test_parallel( infile ) ) {
+			init_get_buffer();
+			nbytes_read = ppp_hdrsize;
+			ppp_discard = 1;
+			nbytes_out = 0;   /* put_out() counts the output, as in d. */
+			if ( fext.ppp_flags & PPP_STREAM ) {
+				decompress_stream( win_buf, 0, -1 );
+				check_stream();
+			}
+			else decompress_frames( win_buf );
+			free_get_buffer();
+		}
+		nbytes_read = nbytes_out;
+		fprintf(stderr, "%s.\n  %s: %lld bytes, %s", ppp_errors ? "FAILED" : "done",
+			infile, (long long) nbytes_out, ppp_errors ? "errors found" :
+			(fext.ppp_flags & PPP_CHECKSUM) ? "checksums OK" : "decodes OK (no checksums)" );
+		goto halt_prog;
 	}
 	else if ( mode == DECOMPRESS ){
 		init_get_buffer();
-		nbytes_read = sizeof(file_stamp);
-		fprintf(stderr, "\n Decoding...");
-		decompress_LZP( win_buf );
+		nbytes_read = ppp_hdrsize;
+		if ( range_len >= 0 && (fext.ppp_flags & PPP_DEDUP) ) {
+			fprintf(stderr, "\n %s: no --range on a dedup file.", infile );
+			goto halt_prog;
+		}
+		else if ( fext.ppp_flags & PPP_STREAM ) {
+			fprintf(stderr, "\n Decoding stream...");
+			decompress_stream( win_buf, range_len >= 0 ? range_off : 0, range_len );
+			check_stream();
+		}
+		else if ( range_len >= 0 && (fext.ppp_flags & PPP_SIZED) && (fstat( fileno( gIN ), &st )
+			|| st.st_size != frame_size) ) {
+			fprintf(stderr, "\n %s: no --range over joined frames.", infile );
+			goto halt_prog;
+		}
+		else if ( range_len >= 0 ) {
+			fprintf(stderr, "\n Decoding range %lld:%lld...", (long long) range_off, (long long) range_len );
+			decompress_range( win_buf, range_off, range_len );
+		}
+		else {
+			fprintf(stderr, "\n Decoding...");
+			decompress_frames( win_buf );
+		}
 		nbytes_read = get_nbytes_read();
 		free_get_buffer();
+		if ( ppp_hole_end ) {
+			/* a trailing hole: extend the file to its size. */
+			fflush( pOUT );
+			if ( ftruncate( fileno( pOUT ), gt_ftell( pOUT ) ) ) ppp_errors++;
+		}
 	}
+	if ( mode == COMPRESS && (fext.ppp_flags & PPP_STREAM) ) put_trailer();
 	flush_put_buffer();
 	
-	if ( mode == COMPRESS ) {
-		rewind( pOUT );
+	if ( mode == COMPRESS && (fext.ppp_flags & PPP_STREAM) ) nbytes_out = get_nbytes_out();
+	else if ( mode == COMPRESS ) {
+		if ( fext.ppp_flags & PPP_RESTART ) {
+			/* seek table trailer */
+			seek_footer sf;
+			memset( &sf, 0, sizeof(sf) );
+			sf.nentries = seek_n;
+			sf.table_offset = nbytes_out;
+			strcpy( sf.magic, "LZPGTSK" );
+			if ( seek_n ) pfwrite( seek_table, sizeof(seek_entry) * seek_n );
+			pfwrite( &sf, sizeof(seek_footer) );
+			nbytes_out += sizeof(seek_entry) * seek_n + sizeof(seek_footer);
+		}
 		fstamp.ppp_nblocks = ppp_nblocks;
 		fstamp.ppp_lastblocksize = ppp_lastblocksize;
 		fstamp.ppp_WBITS = ppp_WBITS;
-		fwrite( &fstamp, sizeof(file_stamp), 1, pOUT );
+		rewrite_put_file( 0, &fstamp, sizeof(file_stamp) );
+		if ( !strcmp( fstamp.alg, "LZPGT8" ) ) {
+			fext.ppp_crc = ppp_crc;
+			rewrite_put_file( sizeof(file_stamp), &fext, sizeof(file_stamp_ext) );
+		}
+		if ( fext.ppp_flags & PPP_SIZED ) {
+			unsigned char b[8];
+			for ( i = 0; i < 8; i++ ) b[i] = (unsigned char) (nbytes_out >> (8*i));
+			rewrite_put_file( ppp_hdrsize - 8, b, 8 );
+		}
+		if ( ckpt_name && !ppp_append ) remove( ckpt_name );   /* done: nothing to resume. */
 	}
 	
 	fprintf(stderr, "done.\n  %s (%lld) -> %s (%lld)", 
-		argv[2], nbytes_read, argv[3], nbytes_out);
+		infile, nbytes_read, outfile, nbytes_out);
 	if ( mode == COMPRESS ) {
 		ratio = (((float) nbytes_read - (float) nbytes_out) /
 			(float) nbytes_read ) * (float) 100;
@@ -144,13 +1117,24 @@ int main( int argc, char *argv[] )
 	halt_prog:
 	
 	free_put_buffer();
-	if ( win_buf ) free( win_buf );
+	if ( win_buf ) free_table( win_buf );
+	if ( ref_table ) free( ref_table );
+	free_dict();
+	if ( seek_table ) free( seek_table );
+	if ( ckpt_name ) free( ckpt_name );
+	if ( ppp_tail ) free( ppp_tail );
+	dedup_free();
+	models_free();
+	if ( rec_hist ) free( rec_hist );
+	free_blocks();
 	fclose( gIN );
-	fclose( pOUT );
+	if ( close_put_file() ) fprintf(stderr, "\n Error writing output file.");
 	if ( mode == DECOMPRESS ) nbytes_read = nbytes_out;
 	fprintf(stderr, " in %3.2f secs (@ %3.2f MB/s)\n",
 		(double)(clock()-start_time) / CLOCKS_PER_SEC, (nbytes_read/1048576)/((double)(clock()-start_time)/ CLOCKS_PER_SEC) );
-	return 0;
+	if ( ppp_maxmem ) report_memory();
+	free( args );
+	return ppp_errors ? 1 : 0;
 }
 
 void copyright( void )
@@ -158,125 +1142,3494 @@ void copyright( void )
 	fprintf(stderr, "\n Written by: Gerald R. Tamayo (c) 2022-2023\n");
 }
 
+/* a stale line: clear it for this epoch. */
+static void tag_line( unsigned char w[], int64_t slot )
+{
+	memset( w + (slot & ~((1<<TAG_BITS)-1)), 0, 1<<TAG_BITS );
+	ppp_tags[ slot >> TAG_BITS ] = ppp_epoch;
+}
+
+/* tags the table of ppp_WSIZE bytes: all its lines start stale, so it
+	need not be cleared. Only for the all-zero initial table.
+*/
+int tags_init( void )
+{
+	free( ppp_tags );
+	ppp_tags = (uint16_t *) calloc( ppp_WSIZE >> TAG_BITS, sizeof(uint16_t) );
+	ppp_epoch = 1;
+	return ppp_tags != NULL;
+}
+
+void tags_free( void )
+{
+	free( ppp_tags );
+	ppp_tags = NULL;
+}
+
 /* PPP style, a simple preprocessor. */
-void compress_LZP( unsigned char w[], unsigned char p[] )
+
+/* codes one block of n bytes: n flag bits, then the mismatched bytes.
+	the block ends on a byte boundary.
+*/
+/* PPP_LZ: the literals LZ coded, or raw when that is not smaller. */
+void put_literals( unsigned char *p, int n )
+{
+	put_packed( p, n, pack_literals( p, n ) );
+}
+
+/* the literals LZ coded into lzbuf: their size, 0 if not smaller. */
+int pack_literals( unsigned char *p, int n )
 {
-	int c, n, nread, prev=0;  /* prev = context hash */
-	unsigned char *ca, *cend;
+	return n > 16 ? lz_compress( p, n, lzbuf, n - 5 ) : 0;
+}
+
+/* the literals, as pack_literals() left them. */
+void put_packed( unsigned char *p, int n, int k )
+{
+	unsigned char *q, *qend;
 	
-	ppp_nblocks = 0;
-	ppp_lastblocksize = 0;
-	while ( (nread=fread(p, 1, PPP_BLOCKSIZE, gIN)) ){
-		n = 0;
-		ca = cend = cbuf;
-		while ( n < nread ) {
-			if ( w[prev] == (c=p[n]) ){  /* Guess/prediction correct */
-				put_ONE();
-			}
-			else {
-				put_ZERO();
-				w[prev] = c;
-				*cend++ = c;  /* record mismatched byte */
-			}
-			prev = ((prev<<5)+c) & ppp_WMASK;  /* update hash */
-			n++;
+	pfputc( k ? 1 : 0 );
+	if ( k ) {
+		put_le32( k );
+		q = lzbuf, qend = lzbuf + k;
+	}
+	else q = p, qend = p + n;
+	while ( q < qend ) pfputc( *q++ );
+}
+
+PPP_INLINE void encode_block_h( unsigned char w[], unsigned char *p, int n, const int hash,
+	const int tagged )
+{
+	int c;
+	int64_t prev = ppp_prev;  /* prev = context hash */
+	unsigned char *ca, *cend, *pend = p + n;
+	uint16_t *tags = ppp_tags, epoch = ppp_epoch;
+	
+	ca = cend = cbuf;
+	while ( p < pend ) {
+		if ( tagged && tags[ prev >> TAG_BITS ] != epoch ) tag_line( w, prev );
+		if ( w[prev] == (c=*p++) ){  /* Guess/prediction correct */
+			put_ONE();
 		}
-		nbytes_read += nread;
-		
-		/* write mismatched bytes. */
-		if ( nread == PPP_BLOCKSIZE ){
-			while ( ca < cend  ) {
-				pfputc( *ca++ );
-			}
-			ppp_nblocks++;
+		else {
+			put_ZERO();
+			w[prev] = c;
+			*cend++ = c;  /* record mismatched byte */
 		}
-		else if ( nread < PPP_BLOCKSIZE ){ /* last blocksize mismatched bytes */
-			/* tricky bits in current *pbuf. */
-			if ( p_cnt > 0 && p_cnt < 8 ){
-				p_cnt = 7;       /* force byte boundary. */
-				advance_buf();   /* writes *pbuf */
-			}
-			/* write mismatched bytes. */
-			while ( ca < cend  ) {
-				pfputc( *ca++ );
-			}
-			ppp_lastblocksize = nread;
+		prev = PPP_HASH( prev, c, hash ) & ppp_WMASK;  /* update hash */
+	}
+	ppp_prev = prev;
+	
+	/* tricky bits in current *pbuf. */
+	if ( p_cnt > 0 && p_cnt < 8 ){
+		p_cnt = 7;       /* force byte boundary. */
+		advance_buf();   /* writes *pbuf */
+	}
+	/* write mismatched bytes. */
+	if ( fext.ppp_flags & PPP_LZ ) put_literals( ca, (int) (cend - ca) );
+	else while ( ca < cend  ) {
+		pfputc( *ca++ );
+	}
+}
+
+/* ---- block models (PPP_MODELS) ---- */
+
+/* learns n bytes as the encoder would, returning its hits. */
+PPP_INLINE int64_t count_hits_h( unsigned char w[], unsigned char *p, int n, int64_t *pprev,
+	const int64_t wmask, const int hash )
+{
+	unsigned char *pend = p + n;
+	int64_t hits = 0;
+	int c;
+	int64_t prev = *pprev;
+	
+	while ( p < pend ) {
+		if ( w[prev] == (c=*p++) ) hits++;
+		else w[prev] = c;
+		prev = PPP_HASH( prev, c, hash ) & wmask;
+	}
+	*pprev = prev;
+	return hits;
+}
+
+/* a trial: codes the block as encode_block_h() would, into the
+	trial's flags and literals.
+*/
+PPP_INLINE void trial_block_h( model_trial *t, unsigned char *p, int n, const int64_t wmask, const int hash,
+	const int tagged )
+{
+	unsigned char *w = t->w, *f = t->flags, *lit = t->lits;
+	int c, i, bits = 0;
+	int64_t prev = t->prev;
+	uint16_t *tags = ppp_tags, epoch = ppp_epoch;
+	
+	for ( i = 0; i < n; i++ ) {
+		if ( tagged && tags[ prev >> TAG_BITS ] != epoch ) tag_line( w, prev );
+		if ( w[prev] == (c=p[i]) ) bits |= 1 << (i&7);
+		else *lit++ = w[prev] = c;
+		prev = PPP_HASH( prev, c, hash ) & wmask;
+		if ( (i&7) == 7 ) {
+			*f++ = bits;
+			bits = 0;
 		}
 	}
+	if ( n & 7 ) *f = bits;
+	t->nlits = (int) (lit - t->lits);
+	t->prev = prev;
 }
 
-void decompress_LZP( unsigned char w[] )
+/* encoding, model k codes the block; decoding, the models other than
+	the block's learn it.
+*/
+static void model_work( int k )
 {
-	int c = 0, i = 0, prev = 0;  /* prev = context hash */
-	unsigned char gb[PPP_BLOCKSIZE/8], *gbstart;
+	model_trial *t = &mdl.t[k];
 	
-	if ( ppp_nblocks > 0 ) while ( ppp_nblocks-- ) {
-		gbstart = gb;
-		for ( i = 0; i < PPP_BLOCKSIZE/8; i++ ) { /* get block of bits */
-			*gbstart++ = *gbuf++;  /* get byte */
-			if ( gbuf == gbuf_end ) {
-				nbytes_read += nfread;
-				gbuf = gbuf_start;
-				nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
-				gbuf_end = (unsigned char *) (gbuf + nfread);
-			}
+	if ( mdl.phase == MODEL_TRIAL ) {
+		switch ( ppp_models[k].hash ) {
+			case HASH_XOR:  trial_block_h( t, mdl.p, mdl.len, ppp_WMASK, HASH_XOR, 0 ); break;
+			case HASH_ADD6: trial_block_h( t, mdl.p, mdl.len, ppp_WMASK, HASH_ADD6, 0 ); break;
+			case HASH_XOR3: trial_block_h( t, mdl.p, mdl.len, ppp_WMASK, HASH_XOR3, 0 ); break;
+			default:        trial_block_h( t, mdl.p, mdl.len, ppp_WMASK, HASH_ADD, 0 );
 		}
-		gbstart = gb;
-		for ( i = 0; i < PPP_BLOCKSIZE; i++ ){
-			if ( (*gbstart) & (1<<(g_cnt++)) ) { /* test bit */
-				pfputc( c=w[prev] );
-			}
-			else {
-				c = *gbuf++;  /* get byte */
-				if ( gbuf == gbuf_end ) {
-					nbytes_read += nfread;
-					gbuf = gbuf_start;
-					nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
-					gbuf_end = (unsigned char *) (gbuf + nfread);
-				}
-				pfputc( w[prev]=c );
-			}
-			prev = ((prev<<5)+c) & ppp_WMASK;
-			if ( g_cnt == 8 ) {
-				g_cnt = 0;
-				++gbstart;
-			}
+	}
+	else if ( mdl.phase == MODEL_UPDATE && k != mdl.win ) {
+		switch ( ppp_models[k].hash ) {
+			case HASH_XOR:  count_hits_h( t->w, mdl.p, mdl.len, &t->prev, ppp_WMASK, HASH_XOR ); break;
+			case HASH_ADD6: count_hits_h( t->w, mdl.p, mdl.len, &t->prev, ppp_WMASK, HASH_ADD6 ); break;
+			case HASH_XOR3: count_hits_h( t->w, mdl.p, mdl.len, &t->prev, ppp_WMASK, HASH_XOR3 ); break;
+			default:        count_hits_h( t->w, mdl.p, mdl.len, &t->prev, ppp_WMASK, HASH_ADD );
 		}
 	}
+}
+
+#if defined( PPP_THREADS )
+static void *model_worker( void *arg )
+{
+	int k = (int) (intptr_t) arg, gen = 0, phase;
 	
-	/* last block */
-	if ( ppp_lastblocksize > 0 ) {
-		gbstart = gb;
-		for ( i = 0; i < ppp_lastblocksize/8; i++ ) { /* get block of bits */
-			*gbstart++ = *gbuf++;  /* get byte */
-			if ( gbuf == gbuf_end ) {
-				nbytes_read += nfread;
-				gbuf = gbuf_start;
-				nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
-				gbuf_end = (unsigned char *) (gbuf + nfread);
-			}
-		}
-		if ( (ppp_lastblocksize%8) ) *gbstart++ = gfgetc();  /* get one more byte */
-		gbstart = gb;
-		for ( i = 0; i < ppp_lastblocksize; i++ ){
-			if ( (*gbstart) & (1<<(g_cnt++)) ) { /* test bit */
-				pfputc( c=w[prev] );
-			}
-			else {
-				c = *gbuf++;  /* get byte */
-				if ( gbuf == gbuf_end ) {
-					nbytes_read += nfread;
-					gbuf = gbuf_start;
-					nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
-					gbuf_end = (unsigned char *) (gbuf + nfread);
-				}
-				pfputc( w[prev]=c );
-			}
-			prev = ((prev<<5)+c) & ppp_WMASK;
-			if ( g_cnt == 8 ) {
-				g_cnt = 0;
-				++gbstart;
-			}
-		}
+	while ( 1 ) {
+		pthread_mutex_lock( &mdl.lock );
+		while ( mdl.gen == gen ) pthread_cond_wait( &mdl.go, &mdl.lock );
+		gen = mdl.gen;
+		phase = mdl.phase;
+		pthread_mutex_unlock( &mdl.lock );
+		if ( phase == MODEL_QUIT ) break;
+		model_work( k );
+		pthread_mutex_lock( &mdl.lock );
+		if ( ++mdl.ndone == mdl.n-1 ) pthread_cond_signal( &mdl.done );
+		pthread_mutex_unlock( &mdl.lock );
+	}
+	return NULL;
+}
+#endif
+
+/* runs a phase on all the models: model 0 here, the rest on the workers. */
+static void models_run( int phase )
+{
+	int k;
+	
+	mdl.phase = phase;
+#if defined( PPP_THREADS )
+	if ( mdl.nthreads ) {
+		pthread_mutex_lock( &mdl.lock );
+		mdl.ndone = 0;
+		mdl.gen++;
+		pthread_cond_broadcast( &mdl.go );
+		pthread_mutex_unlock( &mdl.lock );
+		if ( phase == MODEL_QUIT ) return;
+		model_work( 0 );
+		pthread_mutex_lock( &mdl.lock );
+		while ( mdl.ndone < mdl.n-1 ) pthread_cond_wait( &mdl.done, &mdl.lock );
+		pthread_mutex_unlock( &mdl.lock );
+		return;
 	}
+#endif
+	if ( phase != MODEL_QUIT ) for ( k = 0; k < mdl.n; k++ ) model_work( k );
+}
+
+/* the model tables start as copies of w; the trial buffers are only
+	needed to encode.
+*/
+int models_init( unsigned char w[], int encode )
+{
+	int k, n = ppp_blocksize;
+	
+	for ( k = 0; k < mdl.n; k++ ) {
+		model_trial *t = &mdl.t[k];
+		t->w = k ? (unsigned char *) malloc( ppp_WSIZE ) : w;
+		if ( !t->w ) return 0;
+		if ( k ) memcpy( t->w, w, ppp_WSIZE );
+		t->prev = 0;
+		if ( !encode ) continue;
+		t->flags = (unsigned char *) malloc( n/8 + 1 );
+		t->lits = (unsigned char *) malloc( n );
+		if ( !t->flags || !t->lits ) return 0;
+	}
+#if defined( PPP_THREADS )
+	if ( ppp_nthreads != 1 ) {
+		pthread_mutex_init( &mdl.lock, NULL );
+		pthread_cond_init( &mdl.go, NULL );
+		pthread_cond_init( &mdl.done, NULL );
+		for ( k = 1; k < mdl.n; k++ )
+			if ( pthread_create( &mdl.th[k], NULL, model_worker, (void *) (intptr_t) k ) ) break;
+		mdl.nthreads = k-1;
+		if ( mdl.nthreads < mdl.n-1 ) {  /* fewer threads: run them all here. */
+			models_run( MODEL_QUIT );
+			for ( k = 1; k <= mdl.nthreads; k++ ) pthread_join( mdl.th[k], NULL );
+			mdl.nthreads = 0;
+		}
+	}
+#endif
+	return 1;
+}
+
+void models_free( void )
+{
+	int k;
+	
+#if defined( PPP_THREADS )
+	if ( mdl.nthreads ) {
+		models_run( MODEL_QUIT );
+		for ( k = 1; k <= mdl.nthreads; k++ ) pthread_join( mdl.th[k], NULL );
+		mdl.nthreads = 0;
+	}
+#endif
+	for ( k = 0; k < mdl.n; k++ ) {
+		if ( k ) free( mdl.t[k].w );
+		free( mdl.t[k].flags );
+		free( mdl.t[k].lits );
+	}
+	memset( mdl.t, 0, sizeof(mdl.t) );
+}
+
+/* restart point: model 0 is win_buf, reset by the caller. */
+void models_reset( void )
+{
+	int k;
+	
+	for ( k = 0; k < mdl.n; k++ ) {
+		if ( k ) init_table( mdl.t[k].w );
+		mdl.t[k].prev = 0;
+	}
+}
+
+/* a stored or run block: the models skip it, but their contexts take
+	in its last bytes.
+*/
+void models_tail( unsigned char *p, int n )
+{
+	int i, k, m = n < 32 ? n : 32;
+	
+	for ( k = 0; k < mdl.n; k++ )
+		for ( i = n-m; i < n; i++ )
+			mdl.t[k].prev = PPP_HASH( mdl.t[k].prev, p[i], ppp_models[k].hash ) & ppp_WMASK;
+}
+
+/* every model codes the block (and learns it); the block's model is
+	the one with the fewest literals, the first on a tie.
+*/
+int trial_models( unsigned char *p, int n )
+{
+	int k, win = 0;
+	
+	mdl.p = p, mdl.len = n;
+	models_run( MODEL_TRIAL );
+	for ( k = 1; k < mdl.n; k++ ) if ( mdl.t[k].nlits < mdl.t[win].nlits ) win = k;
+	return win;
+}
+
+/* ---- word prediction (PPP_WORDS) ----
+
+	The unit is a word of ws bytes (little-endian): the table holds
+	ppp_WSIZE/ws words, indexed by a hash of the last 4 words (2 for
+	64-bit words), and a block codes one flag per word, then the
+	mispredicted words and the n%ws tail bytes as literals.
+*/
+static inline int word_shift( int ws )
+{
+	int b = ppp_WBITS - (ws == 2 ? 1 : ws == 4 ? 2 : 3), k = (ws == 8) ? 2 : 4;
+	
+	return (b+k-1) / k;   /* the oldest word is shifted out. */
+}
+
+int count_literals( unsigned char *flags, int n );
+unsigned char *read_literals( unsigned char *out, int n, int lits );
+
+#define WORD_HASH( prev, v, shift ) \
+	(((prev) << (shift)) ^ (int) (((v) * 0x9e3779b97f4a7c15ULL) >> 36))
+
+/* codes a block into gbits (a flag per word) and cbuf (the words
+	mispredicted, then the tail); returns the literal bytes.
+*/
+PPP_INLINE int trial_words_h( unsigned char w[], unsigned char *p, int n, const int ws )
+{
+	int i, bits = 0, nw = n / ws, shift = word_shift( ws );
+	int64_t wmask = (ppp_WMASK+1) / ws - 1, prev = ppp_prev & wmask;
+	unsigned char *f = gbits, *cend = cbuf;
+	uint64_t v, t;
+	
+	for ( i = 0; i < nw; i++, p += ws ) {
+		v = t = 0;
+		memcpy( &v, p, ws );
+		memcpy( &t, w + (size_t) prev * ws, ws );
+		if ( t == v ) bits |= 1 << (i&7);
+		else {
+			memcpy( w + (size_t) prev * ws, p, ws );
+			memcpy( cend, p, ws );
+			cend += ws;
+		}
+		prev = WORD_HASH( prev, v, shift ) & wmask;
+		if ( (i&7) == 7 ) {
+			*f++ = bits;
+			bits = 0;
+		}
+	}
+	if ( nw & 7 ) *f = bits;
+	ppp_prev = prev;
+	for ( i = 0; i < n % ws; i++ ) *cend++ = *p++;   /* the tail */
+	return (int) (cend - cbuf);
+}
+
+/* a stored block: the table learns it as trial_words_h() would. */
+PPP_INLINE void learn_words_h( unsigned char w[], unsigned char *p, int n, const int ws )
+{
+	int i, nw = n / ws, shift = word_shift( ws );
+	int64_t wmask = (ppp_WMASK+1) / ws - 1, prev = ppp_prev & wmask;
+	uint64_t v;
+	
+	for ( i = 0; i < nw; i++, p += ws ) {
+		v = 0;
+		memcpy( &v, p, ws );
+		memcpy( w + (size_t) prev * ws, p, ws );
+		prev = WORD_HASH( prev, v, shift ) & wmask;
+	}
+	ppp_prev = prev;
+}
+
+PPP_INLINE void decode_words_h( unsigned char w[], unsigned char *out, int n, const int ws )
+{
+	int i, nw = n / ws, shift = word_shift( ws );
+	int64_t wmask = (ppp_WMASK+1) / ws - 1, prev = ppp_prev & wmask;
+	int lits;
+	unsigned char *lit;
+	uint64_t v;
+	
+	gb_read( gbits, (nw+7)/8 );
+	lits = count_literals( gbits, nw ) * ws + n % ws;
+	if ( fext.ppp_flags & PPP_LZ ) lit = read_literals( out, n, lits );
+	else {
+		lit = out + n - lits;
+		gb_read( lit, lits );
+	}
+	/* a literal is loaded before its word is stored, at or before it. */
+	for ( i = 0; i < nw; i++ ) {
+		v = 0;
+		if ( gbits[i>>3] & (1<<(i&7)) ) memcpy( &v, w + (size_t) prev * ws, ws );
+		else {
+			memcpy( &v, lit, ws );
+			lit += ws;
+			memcpy( w + (size_t) prev * ws, &v, ws );
+		}
+		memcpy( out + (size_t) i * ws, &v, ws );
+		prev = WORD_HASH( prev, v, shift ) & wmask;
+	}
+	ppp_prev = prev;
+	memmove( out + (size_t) nw * ws, lit, n % ws );
+}
+
+/* ---- record stride (PPP_STRIDE) ----
+
+	For fixed-width records the byte ppp_stride back, at the same
+	offset in the previous record, predicts better than the bytes just
+	before. The context is a hash of that byte, the offset in the
+	record (ppp_phase) and the last byte; rec_hist keeps the previous
+	ppp_stride bytes across blocks.
+*/
+#define STRIDE_HASH( phase, a, c ) \
+	(int64_t) ((((uint32_t) (phase) << 16 | (uint32_t) (a) << 8 | (c)) * 0x9e3779b1u) \
+		>> (ppp_WBITS < 32 ? 32 - ppp_WBITS : 0))   /* 2^32 contexts at most */
+
+int stride_init( void )
+{
+	rec_hist = (unsigned char *) calloc( ppp_stride, 1 );
+	ppp_phase = 0;
+	return rec_hist != NULL;
+}
+
+/* a restart point: no history, the phase from the file offset. */
+void stride_reset( int64_t blockno )
+{
+	memset( rec_hist, 0, ppp_stride );
+	ppp_phase = (int) (blockno * ppp_blocksize % ppp_stride);
+	ppp_prev = 0;
+}
+
+/* after any block: the history, phase and context for the next byte. */
+void stride_tail( unsigned char *p, int n )
+{
+	int s = ppp_stride;
+	
+	if ( n >= s ) memcpy( rec_hist, p + n - s, s );
+	else if ( n > 0 ) {
+		memmove( rec_hist, rec_hist + n, s - n );
+		memcpy( rec_hist + s - n, p, n );
+	}
+	ppp_phase = (int) ((ppp_phase + (int64_t) n) % s);
+	if ( n > 0 ) ppp_prev = STRIDE_HASH( ppp_phase, rec_hist[0], p[n-1] );
+}
+
+/* codes a block into gbits and cbuf; returns the literals. */
+int trial_stride( unsigned char w[], unsigned char *p, int n )
+{
+	int i, c, a, bits = 0, s = ppp_stride, phase = ppp_phase;
+	int64_t prev = ppp_prev;
+	unsigned char *f = gbits, *cend = cbuf;
+	
+	for ( i = 0; i < n; i++ ) {
+		if ( w[prev] == (c=p[i]) ) bits |= 1 << (i&7);
+		else {
+			w[prev] = c;
+			*cend++ = c;
+		}
+		if ( ++phase == s ) phase = 0;
+		a = (i+1 >= s) ? p[i+1-s] : rec_hist[i+1];
+		prev = STRIDE_HASH( phase, a, c );
+		if ( (i&7) == 7 ) {
+			*f++ = bits;
+			bits = 0;
+		}
+	}
+	if ( n & 7 ) *f = bits;
+	stride_tail( p, n );
+	return (int) (cend - cbuf);
+}
+
+void decode_stride( unsigned char w[], unsigned char *out, int n )
+{
+	int i, c, a, s = ppp_stride, phase = ppp_phase, lits;
+	int64_t prev = ppp_prev;
+	unsigned char *lit;
+	
+	gb_read( gbits, (n+7)/8 );
+	lits = count_literals( gbits, n );
+	if ( fext.ppp_flags & PPP_LZ ) lit = read_literals( out, n, lits );
+	else {
+		lit = out + n - lits;
+		gb_read( lit, lits );
+	}
+	for ( i = 0; i < n; i++ ) {
+		if ( gbits[i>>3] & (1<<(i&7)) ) c = w[prev];
+		else w[prev] = c = *lit++;
+		out[i] = c;
+		if ( ++phase == s ) phase = 0;
+		a = (i+1 >= s) ? out[i+1-s] : rec_hist[i+1];
+		prev = STRIDE_HASH( phase, a, c );
+	}
+	stride_tail( out, n );
+}
+
+/* the hits of stride s over p[n], from phase and history hist; with
+	keep the table is left as it was (n <= FILTER_SAMPLE).
+*/
+int probe_stride( unsigned char w[], unsigned char *p, int n, int s, int phase,
+	unsigned char *hist, int64_t prev, int keep )
+{
+	static int64_t idx[ FILTER_SAMPLE ];
+	static unsigned char old[ FILTER_SAMPLE ];
+	int c, i, k = 0, hits = 0;
+	
+	for ( i = 0; i < n; i++ ) {
+		if ( w[prev] == (c=p[i]) ) hits++;
+		else {
+			if ( keep ) idx[k] = prev, old[k++] = w[prev];
+			w[prev] = c;
+		}
+		if ( ++phase == s ) phase = 0;
+		prev = STRIDE_HASH( phase, (i+1 >= s) ? p[i+1-s] : hist[i+1], c );
+	}
+	while ( k-- ) w[ idx[k] ] = old[k];
+	return hits;
+}
+
+/* the bytes of p[n] equal to the byte s back, 8 at a time. */
+static int lag_matches( unsigned char *p, int n, int s )
+{
+	const uint64_t lo = 0x7f7f7f7f7f7f7f7fULL;
+	uint64_t a, b, x;
+	int i, m = 0;
+	
+	for ( i = s; i + 8 <= n; i += 8 ) {
+		memcpy( &a, p+i, 8 );
+		memcpy( &b, p+i-s, 8 );
+		x = a ^ b;
+		x = ~(((x & lo) + lo) | x | lo) >> 7;   /* 1 per zero byte */
+		m += (int) ((x * 0x0101010101010101ULL) >> 56);
+	}
+	return m;
+}
+
+/* --stride auto: the stride whose lag matches the most bytes in the
+	first FILTER_SAMPLE bytes (a longer one must match 1/8 more), kept
+	if its model beats the plain one by 1/32 on the first STRIDE_SAMPLE
+	bytes; 0 if none does.
+*/
+int detect_stride( char *infile )
+{
+	FILE *fp;
+	unsigned char *p, *w, *hist;
+	int64_t hits;
+	int n, s, m, k, best = 0, best_m = 0;
+	int64_t prev = 0;
+	
+	if ( !strcmp( infile, "-" ) || (fp = fopen( infile, "rb" )) == NULL ) {
+		fprintf(stderr, "\n --stride auto needs an input file; no stride.");
+		return 0;
+	}
+	p = (unsigned char *) malloc( STRIDE_SAMPLE );
+	w = (unsigned char *) calloc( (size_t) 1 << ppp_WBITS, 1 );
+	hist = (unsigned char *) calloc( STRIDE_AUTOMAX+1, 1 );
+	n = (p && w && hist) ? (int) fread( p, 1, STRIDE_SAMPLE, fp ) : 0;
+	fclose( fp );
+	m = n < FILTER_SAMPLE ? n : FILTER_SAMPLE;
+	for ( s = 2; s <= STRIDE_AUTOMAX && 4*s <= m; s++ ) {
+		k = lag_matches( p, m, s );
+		if ( k > best_m + best_m/8 ) best = s, best_m = k;
+	}
+	if ( best ) {
+		ppp_WMASK = ((int64_t) 1 << ppp_WBITS) - 1;
+		hits = count_hits_h( w, p, n, &prev, ppp_WMASK, ppp_hash );
+		memset( w, 0, (size_t) 1 << ppp_WBITS );
+		if ( probe_stride( w, p, n, best, 0, hist, 0, 0 ) < hits + n/32 ) best = 0;
+	}
+	free( hist );
+	free( w );
+	free( p );
+	return best;
+}
+
+/* refills the get buffer; past the end of a (truncated) input it
+	reads zeros rather than running off the buffer.
+*/
+static inline void gbuf_refill( void )
+{
+	nbytes_read += nfread;
+	gbuf = gbuf_start;
+	nfread = fread ( gbuf, 1, gBUFSIZE, gIN );
+	if ( nfread == 0 ) {
+		memset( gbuf, 0, gBUFSIZE );
+		gbuf_end = gbuf + gBUFSIZE;
+		ppp_eof_fill++;
+	}
+	else gbuf_end = (unsigned char *) (gbuf + nfread);
+}
+
+/* ---- Stored blocks ---- */
+
+/* hits of the model over p[0..n); its table writes are undone. */
+PPP_INLINE int probe_block_h( unsigned char w[], unsigned char *p, int n, const int hash )
+{
+	static int64_t idx[ FILTER_SAMPLE ];   /* the larger sample. */
+	static unsigned char old[ FILTER_SAMPLE ];
+	int c, i, k = 0, hits = 0;
+	int64_t prev = ppp_prev;
+	
+	for ( i = 0; i < n; i++ ) {
+		if ( w[prev] == (c=p[i]) ) hits++;
+		else {
+			idx[k] = prev, old[k++] = w[prev];
+			w[prev] = c;
+		}
+		prev = PPP_HASH( prev, c, hash ) & ppp_WMASK;
+	}
+	while ( k-- ) w[ idx[k] ] = old[k];
+	return hits;
+}
+
+/* probe_block_h() for PPP_WORDS: the bytes in predicted words. */
+PPP_INLINE int probe_words_h( unsigned char w[], unsigned char *p, int n, const int ws )
+{
+	static int64_t idx[ FILTER_SAMPLE/2 ];
+	static uint64_t old[ FILTER_SAMPLE/2 ];
+	int i, k = 0, hits = 0, shift = word_shift( ws );
+	int64_t wmask = (ppp_WMASK+1) / ws - 1, prev = ppp_prev & wmask;
+	uint64_t v, t;
+	
+	for ( i = 0; i + ws <= n; i += ws ) {
+		v = t = 0;
+		memcpy( &v, p+i, ws );
+		memcpy( &t, w + (size_t) prev * ws, ws );
+		if ( t == v ) hits += ws;
+		else {
+			idx[k] = prev, old[k++] = t;
+			memcpy( w + (size_t) prev * ws, &v, ws );
+		}
+		prev = WORD_HASH( prev, v, shift ) & wmask;
+	}
+	while ( k-- ) memcpy( w + (size_t) idx[k] * ws, &old[k], ws );
+	return hits;
+}
+
+/* the model's hits over p[n], the table left as it is. */
+int probe_block( unsigned char w[], unsigned char *p, int n )
+{
+	if ( ppp_stride ) return probe_stride( w, p, n, ppp_stride, ppp_phase, rec_hist, ppp_prev, 1 );
+	if ( ppp_word == 2 ) return probe_words_h( w, p, n, 2 );
+	if ( ppp_word == 4 ) return probe_words_h( w, p, n, 4 );
+	if ( ppp_word == 8 ) return probe_words_h( w, p, n, 8 );
+	if ( ppp_hash == HASH_XOR ) return probe_block_h( w, p, n, HASH_XOR );
+	return probe_block_h( w, p, n, HASH_ADD );
+}
+
+/* the context hash after n more bytes: only the last few bytes are
+	still in it once they have shifted the rest out of ppp_WMASK.
+*/
+int64_t hash_tail( int64_t prev, unsigned char *p, int n )
+{
+	int k = (ppp_WBITS + 3) / 4;
+	
+	if ( n > k ) {
+		p += n - k;
+		n = k;
+		prev = 0;
+	}
+	while ( n-- ) prev = PPP_HASH( prev, *p++, ppp_hash ) & ppp_WMASK;
+	return prev;
+}
+
+/* raw block: the bit buffer is flushed and the block written as is. */
+void put_stored( unsigned char *p, int n )
+{
+	flush_put_buffer();
+	pfwrite( p, n );
+	nbytes_out += n;
+}
+
+/* n bytes from the get buffer. */
+void gb_read( unsigned char *p, int n )
+{
+	int m;
+	
+	while ( n ) {
+		m = (int) (gbuf_end - gbuf) < n ? (int) (gbuf_end - gbuf) : n;
+		memcpy( p, gbuf, m );
+		p += m, gbuf += m, n -= m;
+		if ( gbuf == gbuf_end ) gbuf_refill();
+	}
+}
+
+/* a stored block: the tables learn it as the coder did in trial. */
+PPP_INLINE void learn_block_h( unsigned char w[], unsigned char *p, int n, const int hash,
+	const int tagged )
+{
+	unsigned char *pend = p + n;
+	int64_t prev = ppp_prev;
+	uint16_t *tags = ppp_tags, epoch = ppp_epoch;
+	
+	while ( p < pend ) {
+		if ( tagged && tags[ prev >> TAG_BITS ] != epoch ) tag_line( w, prev );
+		w[prev] = *p;
+		prev = PPP_HASH( prev, *p++, hash ) & ppp_WMASK;
+	}
+	ppp_prev = prev;
+}
+
+void learn_block( unsigned char w[], unsigned char *p, int n )
+{
+	if ( ppp_stride ) {
+		probe_stride( w, p, n, ppp_stride, ppp_phase, rec_hist, ppp_prev, 0 );
+		stride_tail( p, n );
+	}
+	else if ( ppp_word == 2 ) learn_words_h( w, p, n, 2 );
+	else if ( ppp_word == 4 ) learn_words_h( w, p, n, 4 );
+	else if ( ppp_word == 8 ) learn_words_h( w, p, n, 8 );
+	else if ( fext.ppp_flags & PPP_MODELS ) {
+		mdl.p = p, mdl.len = n, mdl.win = -1;
+		models_run( MODEL_UPDATE );
+	}
+	else if ( ppp_tags ) {
+		if ( ppp_hash == HASH_XOR ) learn_block_h( w, p, n, HASH_XOR, 1 );
+		else learn_block_h( w, p, n, HASH_ADD, 1 );
+	}
+	else if ( ppp_hash == HASH_XOR ) learn_block_h( w, p, n, HASH_XOR, 0 );
+	else learn_block_h( w, p, n, HASH_ADD, 0 );
+}
+
+void get_stored( unsigned char w[], unsigned char *out, int n )
+{
+	gb_read( out, n );
+	learn_block( w, out, n );
+}
+
+/* a raw or run block: the contexts take in its last bytes. */
+void skip_block( unsigned char *p, int n )
+{
+	ppp_prev = hash_tail( ppp_prev, p, n );
+	if ( fext.ppp_flags & PPP_MODELS ) models_tail( p, n );
+	if ( ppp_stride ) stride_tail( p, n );
+}
+
+/* a raw block: the tables learn its sample only. */
+void learn_raw( unsigned char w[], unsigned char *p, int n )
+{
+	int m = n < STORE_SAMPLE ? n : STORE_SAMPLE;
+	
+	learn_block( w, p, m );
+	skip_block( p + m, n - m );
+}
+
+/* the hits over m of the n bytes, in STORE_PIECES pieces across the
+	block, so a block only partly noise is not taken for noise; a piece
+	takes the context at the block start, so its first bytes may miss.
+	PPP_MODELS: model 0's (add5, on w).
+*/
+int store_sample( unsigned char w[], unsigned char *p, int n, int m )
+{
+	int64_t prev = ppp_prev;
+	int i, off, hits = 0, k = 1;
+	
+	if ( m < n ) k = STORE_PIECES, m /= STORE_PIECES;
+	if ( fext.ppp_flags & PPP_MODELS ) ppp_prev = mdl.t[0].prev;
+	for ( i = 0; i < k; i++ ) {
+		off = (int) ((int64_t) n * i / k) & ~7;
+		if ( ppp_stride && off >= ppp_stride )
+			hits += probe_stride( w, p + off, m, ppp_stride, (int) ((ppp_phase + off) % ppp_stride),
+				p + off - ppp_stride, ppp_prev, 1 );
+		else if ( fext.ppp_flags & PPP_MODELS ) hits += probe_block_h( w, p + off, m, HASH_ADD );
+		else hits += probe_block( w, p + off, m );
+	}
+	ppp_prev = prev;
+	return hits;
+}
+
+/* 1 if p[0..n) is one byte value; SSE2 compares 64 bytes a step. */
+int is_run( unsigned char *p, int n )
+{
+	unsigned char c = p[0];
+	int i = 0;
+#if defined( __SSE2__ )
+	__m128i v = _mm_set1_epi8( (char) c ), a, b;
+	
+	for ( ; i + 64 <= n; i += 64 ) {
+		a = _mm_and_si128( _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (p+i) ), v ),
+			_mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (p+i+16) ), v ) );
+		b = _mm_and_si128( _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (p+i+32) ), v ),
+			_mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (p+i+48) ), v ) );
+		if ( _mm_movemask_epi8( _mm_and_si128( a, b ) ) != 0xffff ) return 0;
+	}
+#else
+	uint64_t v = c * 0x0101010101010101ULL, x;
+	
+	for ( ; i + 8 <= n; i += 8 ) {
+		memcpy( &x, p+i, 8 );
+		if ( x != v ) return 0;
+	}
+#endif
+	for ( ; i < n; i++ ) if ( p[i] != c ) return 0;
+	return 1;
+}
+
+/* the plain model's trial, into gbits and cbuf; returns the literals. */
+int trial_plain( unsigned char w[], unsigned char *p, int n )
+{
+	model_trial t;
+	
+	t.w = w, t.flags = gbits, t.lits = cbuf, t.prev = ppp_prev;
+	if ( ppp_tags ) {
+		if ( ppp_hash == HASH_XOR ) trial_block_h( &t, p, n, ppp_WMASK, HASH_XOR, 1 );
+		else trial_block_h( &t, p, n, ppp_WMASK, HASH_ADD, 1 );
+	}
+	else if ( ppp_hash == HASH_XOR ) trial_block_h( &t, p, n, ppp_WMASK, HASH_XOR, 0 );
+	else trial_block_h( &t, p, n, ppp_WMASK, HASH_ADD, 0 );
+	ppp_prev = t.prev;
+	return t.nlits;
+}
+
+/* a block coded in trial: the flag bytes, then the literals. */
+void put_coded( unsigned char *flags, int nf, unsigned char *lits, int nlits, int k )
+{
+	unsigned char *q;
+	
+	for ( q = flags; q < flags + nf; q++ ) pfputc( *q );
+	if ( fext.ppp_flags & PPP_LZ ) put_packed( lits, nlits, k );
+	else for ( q = lits; q < lits + nlits; q++ ) pfputc( *q );
+}
+
+/* the plain model codes straight to the bit buffer; the others code
+	the block in trial first, as does the plain one with PPP_STORED
+	when the sample leaves it in doubt.
+*/
+void encode_coded( unsigned char w[], unsigned char *p, int n )
+{
+	unsigned char *flags = gbits, *lits = cbuf;
+	int nf = (n+7)/8, nlits, k = 0, win = -1, size, hits = 0, m = 0;
+	
+	if ( fext.ppp_flags & PPP_STORED ) {
+		m = STORE_SAMPLE * (ppp_word ? ppp_word : 1);   /* as many words as bytes */
+		if ( m > n ) m = n;
+		hits = store_sample( w, p, n, m );
+		if ( hits*16 * (ppp_word ? ppp_word : 1) < m && !(fext.ppp_flags & PPP_LZ)
+			&& store_raw < STORE_RETRY ) {
+			store_raw++;
+			pfputc( BLOCK_RAW );
+			put_stored( p, n );
+			learn_raw( w, p, n );
+			return;
+		}
+		store_raw = 0;
+	}
+	if ( ppp_stride ) nlits = trial_stride( w, p, n );
+	else if ( ppp_word ) {
+		if ( ppp_word == 2 ) nlits = trial_words_h( w, p, n, 2 );
+		else if ( ppp_word == 4 ) nlits = trial_words_h( w, p, n, 4 );
+		else nlits = trial_words_h( w, p, n, 8 );
+		nf = (n/ppp_word + 7) / 8;
+	}
+	else if ( fext.ppp_flags & PPP_MODELS ) {
+		win = trial_models( p, n );
+		flags = mdl.t[win].flags, lits = mdl.t[win].lits, nlits = mdl.t[win].nlits;
+	}
+	else if ( (fext.ppp_flags & PPP_STORED) && hits*4 < m ) nlits = trial_plain( w, p, n );
+	else {
+		if ( fext.ppp_flags & PPP_STORED ) pfputc( BLOCK_CODED );
+		if ( ppp_tags ) {
+			if ( ppp_hash == HASH_XOR ) encode_block_h( w, p, n, HASH_XOR, 1 );
+			else encode_block_h( w, p, n, HASH_ADD, 1 );
+		}
+		else if ( ppp_hash == HASH_XOR ) encode_block_h( w, p, n, HASH_XOR, 0 );
+		else encode_block_h( w, p, n, HASH_ADD, 0 );
+		return;
+	}
+	if ( fext.ppp_flags & PPP_LZ ) k = pack_literals( lits, nlits );
+	if ( fext.ppp_flags & PPP_STORED ) {
+		size = nf + (win >= 0) + ((fext.ppp_flags & PPP_LZ) ? 1 + (k ? 4 + k : nlits) : nlits);
+		if ( size >= n ) {
+			pfputc( BLOCK_STORED );
+			put_stored( p, n );
+			return;
+		}
+		pfputc( BLOCK_CODED );
+	}
+	if ( win >= 0 ) {
+		mdl.count[win]++;
+		pfputc( win );
+	}
+	put_coded( flags, nf, lits, nlits, k );
+}
+
+void put_run( unsigned char *p, int n )
+{
+	pfputc( BLOCK_RUN );
+	pfputc( p[0] );
+	skip_block( p, n );
+}
+
+/* the first run of RUN_MINLEN or more in p[from..n): its start and,
+	in *end, its end; n and n if there is none. Such a run holds 8
+	bytes at a multiple of RUN_MINLEN/2, so only those are probed.
+*/
+int find_run( unsigned char *p, int n, int from, int *end )
+{
+	int i, a, b, step = RUN_MINLEN/2;
+	
+	for ( i = (from + step-1) / step * step; i + 8 <= n; i += step ) {
+		if ( !is_run( p+i, 8 ) ) continue;
+		for ( a = i; a > from && p[a-1] == p[i]; a-- ) ;
+		for ( b = i+8; b < n && p[b] == p[i]; b++ ) ;
+		if ( b - a >= RUN_MINLEN ) {
+			*end = b;
+			return a;
+		}
+	}
+	*end = n;
+	return n;
+}
+
+void encode_typed( unsigned char w[], unsigned char *p, int n )
+{
+	int i, a, e;
+	
+	if ( (fext.ppp_flags & PPP_STORED) && n ) {
+		if ( is_run( p, n ) ) {
+			put_run( p, n );
+			return;
+		}
+		if ( find_run( p, n, 0, &e ) < n ) {
+			pfputc( BLOCK_SPLIT );
+			for ( i = 0; i < n; i = e ) {
+				a = find_run( p, n, i, &e );
+				if ( a > i ) {
+					put_le32( a - i );
+					encode_coded( w, p + i, a - i );
+				}
+				if ( a < n ) {
+					put_le32( e - a );
+					put_run( p + a, e - a );
+				}
+			}
+			return;
+		}
+	}
+	encode_coded( w, p, n );
+}
+
+/* --filter auto: the filter whose output the model predicts best over
+	FILTER_SAMPLE bytes from the middle of the block, with the table as
+	it is now; another filter must win by 1/16 of the sample to replace
+	none.
+*/
+int choose_filter( unsigned char w[], unsigned char *p, int n )
+{
+	int id, hits, best = FILTER_NONE, best_hits = -1, m = n < FILTER_SAMPLE ? n : FILTER_SAMPLE;
+	
+	for ( id = FILTER_NONE; id <= FILTER_MAX; id++ ) {
+		filter_fwd( id, p + (n-m)/2, fbuf, m );
+		hits = probe_block( w, fbuf, m );
+		if ( id == FILTER_NONE ) hits += m/16;
+		if ( hits > best_hits ) best = id, best_hits = hits;
+	}
+	return best;
+}
+
+void encode_block( unsigned char w[], unsigned char *p, int n )
+{
+	int id;
+	
+	if ( fext.ppp_flags & PPP_FILTER ) {
+		id = (ppp_filter == FILTER_AUTO) ? choose_filter( w, p, n ) : ppp_filter;
+		pfputc( id );
+		filter_count[id]++;
+		if ( id != FILTER_NONE ) {
+			filter_fwd( id, p, fbuf, n );
+			p = fbuf;
+		}
+	}
+	encode_typed( w, p, n );
+}
+
+/* the initial table: all zeros, or the dictionary. */
+void init_table( unsigned char w[] )
+{
+	if ( ref_table ) memcpy( w, ref_table, ppp_WSIZE );
+	else if ( dict_map ) memcpy( w, dict_map, ppp_WSIZE );
+	else memset( w, 0, ppp_WSIZE );
+}
+
+void reset_table( unsigned char w[] )
+{
+	ppp_prev = 0;
+	store_raw = STORE_RETRY;
+	if ( ppp_tags ) {
+		if ( ++ppp_epoch == 0 ) {  /* wrapped: every line stale again. */
+			memset( ppp_tags, 0, (ppp_WSIZE >> TAG_BITS) * sizeof(uint16_t) );
+			ppp_epoch = 1;
+		}
+		return;
+	}
+#if defined( PPP_MMAP )
+	/* a fresh copy-on-write mapping drops our writes; no copying. */
+	if ( w == win_buf && win_buf_mapped == 1 && !ref_table && mmap( w, ppp_WSIZE, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_FIXED, dict_fd, DICT_HDRSIZE ) != MAP_FAILED ) return;
+	/* a lazy table: give the pages back, they fault in as zeros. */
+	if ( w == win_buf && win_buf_mapped == 2 && !ref_table && !madvise( w, ppp_WSIZE, MADV_DONTNEED ) )
+		return;
+#endif
+	init_table( w );
+}
+
+/* restart point: reset the table; the encoder also records it. */
+void restart_block( unsigned char w[], int64_t blockno, int encoding )
+{
+	if ( !(fext.ppp_flags & PPP_RESTART) || blockno % fext.ppp_restart ) return;
+	if ( blockno ) reset_table( w );
+	if ( blockno && (fext.ppp_flags & PPP_MODELS) ) models_reset();
+	if ( ppp_stride ) stride_reset( blockno );
+	if ( !encoding ) return;
+	if ( seek_n == seek_max ) {
+		seek_max = seek_max ? 2*seek_max : 1024;
+		seek_table = (seek_entry *) realloc( seek_table, sizeof(seek_entry) * seek_max );
+		if ( !seek_table ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+	}
+	seek_table[ seek_n ].uoffset = blockno * ppp_blocksize;
+	seek_table[ seek_n++ ].coffset = get_nbytes_out();
+}
+
+/* Reads the next block. With a sparse input a block that lies in a
+	hole is not read: the file is seeked past it and p[] zeroed.
+*/
+int read_block( unsigned char *p, int n )
+{
+#if defined( SEEK_DATA ) && !defined( _WIN32 )
+	int64_t pos, data, end;
+	int fd;
+#endif
+	
+	if ( fext.ppp_flags & PPP_DEDUP ) return dedup_read( p, n );
+	if ( ppp_tail_n ) {
+		int t = ppp_tail_n;
+		memcpy( p, ppp_tail, t );
+		ppp_tail_n = 0;
+		return t + (int) fread( p + t, 1, n - t, gIN );
+	}
+#if defined( SEEK_DATA ) && !defined( _WIN32 )
+	if ( ppp_sparse_in && (fext.ppp_flags & PPP_STORED) ) {
+		fd = fileno( gIN );
+		pos = gt_ftell( gIN );
+		data = lseek( fd, pos, SEEK_DATA );
+		if ( data < 0 && errno == ENXIO ) {  /* a hole up to EOF */
+			end = lseek( fd, 0, SEEK_END );
+			if ( end - pos < n ) n = end > pos ? (int) (end - pos) : 0;
+			data = pos + n;
+		}
+		if ( data >= pos + n ) {
+			gt_fseek( gIN, pos + n, SEEK_SET );
+			memset( p, 0, n );
+			return n;
+		}
+		gt_fseek( gIN, pos, SEEK_SET );
+	}
+#endif
+	return (int) fread( p, 1, n, gIN );
+}
+
+void compress_LZP( unsigned char w[], unsigned char p[] )
+{
+	int nread;
+	
+	ppp_nblocks = ckpt.nblocks;   /* 0, or a resumed run's */
+	ppp_lastblocksize = 0;
+	while ( (nread=read_block( p, (ppp_in_left >= 0 && ppp_in_left < ppp_blocksize)
+		? (int) ppp_in_left : ppp_blocksize )) ){
+		if ( ppp_in_left > 0 ) ppp_in_left -= nread;
+		if ( ppp_append && nread < ppp_blocksize ) save_checkpoint( w, p, nread, 1 );
+		restart_block( w, ppp_nblocks, 1 );
+		if ( fext.ppp_flags & PPP_STREAM ) put_le32( nread );
+		encode_block( w, p, nread );
+		if ( fext.ppp_flags & PPP_CHECKSUM ) put_checksum( p, nread );
+		nbytes_read += nread;
+		if ( nread == ppp_blocksize ) ppp_nblocks++;
+		else ppp_lastblocksize = nread;  /* last block */
+		if ( ppp_ckpt && nbytes_read >= ppp_ckpt_next && nread == ppp_blocksize ) {
+			save_checkpoint( w, p, nread, 0 );
+			ppp_ckpt_next = (nbytes_read / ppp_ckpt + 1) * ppp_ckpt;
+		}
+	}
+	if ( ppp_append && !ppp_lastblocksize ) save_checkpoint( w, p, 0, 1 );
+}
+
+#if defined( PPP_THREADS )
+static void follow_stop( int sig )
+{
+	(void) sig;
+	ppp_stop = 1;
+}
+
+/* --follow: codes a growing file as tail -f reads it, until SIGINT or
+	SIGTERM (or the end of a pipe). Bytes wait at most ppp_flush_ms, or
+	until there are ppp_flush_size of them, then they are coded as a
+	frame: a PPP_FRAMES block, byte aligned like any block, and written
+	out at once. A reader decodes up to the last complete frame. The
+	table carries across frames.
+*/
+void follow_LZP( unsigned char w[], unsigned char p[] )
+{
+	struct stat st;
+	struct pollfd pfd;
+	struct timespec nap;
+	int fd = fileno( gIN ), k = 0, r, limit, pipe_in;
+	int64_t total = 0, nframes = 0;
+	double first = 0, left;
+	
+	pipe_in = fstat( fd, &st ) == 0 && !S_ISREG( st.st_mode );
+	pfd.fd = fd, pfd.events = POLLIN;
+	limit = (ppp_flush_size && ppp_flush_size < ppp_blocksize) ? (int) ppp_flush_size : ppp_blocksize;
+	nap.tv_sec = 0;
+	nap.tv_nsec = (ppp_flush_ms < 10 ? ppp_flush_ms : 10) * 1000000L;
+	signal( SIGINT, follow_stop );
+	signal( SIGTERM, follow_stop );
+	while ( !ppp_stop || k ) {
+		left = k ? first + ppp_flush_ms / 1e3 - wall_secs() : 0.1;
+		r = -1;
+		if ( ppp_stop ) ;
+		else if ( !pipe_in ) r = (int) read( fd, p + k, limit - k );
+		else if ( poll( &pfd, 1, left > 0 ? (int) (left * 1e3) + 1 : 0 ) > 0
+			&& (r = (int) read( fd, p + k, limit - k )) == 0 ) ppp_stop = 1;  /* the writer is gone. */
+		if ( r > 0 ) {
+			if ( k == 0 ) first = wall_secs();
+			k += r;
+		}
+		if ( k && (k == limit || ppp_stop || wall_secs() >= first + ppp_flush_ms / 1e3) ) {
+			put_le32( k );
+			encode_block( w, p, k );
+			if ( fext.ppp_flags & PPP_CHECKSUM ) put_checksum( p, k );
+			flush_put_buffer();
+			fflush( pOUT );
+			total += k;
+			nframes++;
+			k = 0;
+		}
+		else if ( r <= 0 && !pipe_in && !ppp_stop ) nanosleep( &nap, NULL );   /* no new data yet. */
+	}
+	signal( SIGINT, SIG_DFL );
+	signal( SIGTERM, SIG_DFL );
+	fprintf(stderr, "%lld frames, ", (long long) nframes );
+	nbytes_read = total;
+	ppp_nblocks = total / ppp_blocksize;
+	ppp_lastblocksize = (int) (total % ppp_blocksize);
+}
+#endif
+
+/* ---- checkpoints (--checkpoint, --resume) ---- */
+
+/* n bytes in CKPT_CHUNK pieces, each gtlz coded or raw. */
+int ckpt_put( FILE *fp, unsigned char *p, int64_t n )
+{
+	unsigned char *buf = (unsigned char *) malloc( CKPT_CHUNK ), b[4];
+	int m, k, ok = buf != NULL;
+	uint32_t v;
+	
+	for ( ; ok && n > 0; p += m, n -= m ) {
+		m = n < CKPT_CHUNK ? (int) n : CKPT_CHUNK;
+		k = lz_compress( p, m, buf, m );
+		v = k ? (uint32_t) k : CKPT_RAW | (uint32_t) m;
+		b[0] = v, b[1] = v >> 8, b[2] = v >> 16, b[3] = v >> 24;
+		ok = fwrite( b, 4, 1, fp ) == 1 && fwrite( k ? buf : p, k ? k : m, 1, fp ) == 1;
+	}
+	free( buf );
+	return ok;
+}
+
+int ckpt_get( FILE *fp, unsigned char *p, int64_t n )
+{
+	unsigned char *buf = (unsigned char *) malloc( CKPT_CHUNK ), b[4];
+	int m, ok = buf != NULL;
+	uint32_t v;
+	
+	for ( ; ok && n > 0; p += m, n -= m ) {
+		m = n < CKPT_CHUNK ? (int) n : CKPT_CHUNK;
+		if ( !(ok = fread( b, 4, 1, fp ) == 1) ) break;
+		v = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t) b[3] << 24;
+		if ( v & CKPT_RAW ) ok = (v & ~CKPT_RAW) == (uint32_t) m && fread( p, m, 1, fp ) == 1;
+		else ok = v < (uint32_t) m && fread( buf, v, 1, fp ) == 1
+			&& lz_decompress( buf, buf + v, p, m ) == buf + v;
+	}
+	free( buf );
+	return ok;
+}
+
+/* After a full block: syncs the output, then writes the checkpoint
+	aside and renames it over the last one, so the checkpoint on disk
+	always matches output that is on disk. A failed checkpoint is only
+	reported; the run goes on. done: p[] is the short last block (or
+	nothing), not yet coded.
+*/
+void save_checkpoint( unsigned char w[], unsigned char *p, int n, int done )
+{
+	ckpt_stamp ck = ckpt;
+	char *tmp = (char *) malloc( strlen( ckpt_name ) + 5 );
+	FILE *fp = NULL;
+	int ok = 0;
+	
+	flush_put_buffer();   /* byte aligned: nothing is padded. */
+	fflush( pOUT );
+#if !defined( _WIN32 )
+	fsync( fileno( pOUT ) );
+#endif
+	strcpy( ck.magic, "LZPGTCK" );
+	ck.in_offset = nbytes_read;
+	ck.out_size = nbytes_out;
+	ck.nblocks = ppp_nblocks;
+	ck.prev = ppp_prev;
+	ck.seek_n = seek_n;
+	memcpy( ck.filter_count, filter_count, sizeof(filter_count) );
+	ck.crc = ppp_crc;
+	ck.last_crc = done ? 0 : crc32c( 0, p, n );
+	ck.last_n = done ? 0 : n;
+	ck.phase = ppp_phase;
+	ck.store_raw = store_raw;
+	ck.wbits = ppp_WBITS;
+	ck.done = done;
+	ck.tail_n = done ? n : 0;
+	if ( tmp ) {
+		sprintf( tmp, "%s.tmp", ckpt_name );
+		if ( (fp = fopen( tmp, "wb" )) != NULL ) {
+			ok = fwrite( &ck, sizeof(ck), 1, fp ) == 1
+				&& (!seek_n || fwrite( seek_table, sizeof(seek_entry) * seek_n, 1, fp ) == 1)
+				&& (!ppp_stride || fwrite( rec_hist, ppp_stride, 1, fp ) == 1)
+				&& ckpt_put( fp, w, ppp_WSIZE ) && (!ck.tail_n || fwrite( p, ck.tail_n, 1, fp ) == 1)
+				&& fflush( fp ) == 0;
+#if !defined( _WIN32 )
+			if ( ok ) ok = fsync( fileno( fp ) ) == 0;
+#endif
+			if ( fclose( fp ) ) ok = 0;
+#if defined( _WIN32 )
+			remove( ckpt_name );   /* rename() doesn't replace. */
+#endif
+			if ( ok ) ok = rename( tmp, ckpt_name ) == 0;
+			else remove( tmp );
+		}
+		free( tmp );
+	}
+	if ( !ok ) fprintf(stderr, "\n Warning: checkpoint %s not written.", ckpt_name );
+}
+
+/* Reads the stamp of outfile.ckpt; the file is left at the seek entries. */
+FILE *open_checkpoint( ckpt_stamp *ck )
+{
+	FILE *fp = fopen( ckpt_name, "rb" );
+	
+	if ( !fp ) {
+		fprintf(stderr, "\n No checkpoint %s to resume from.", ckpt_name );
+		return NULL;
+	}
+	if ( fread( ck, sizeof(ckpt_stamp), 1, fp ) != 1 || strcmp( ck->magic, "LZPGTCK" )
+		|| ck->hdrsize < 0 || ck->hdrsize > CKPT_HDRMAX || ck->seek_n < 0
+		|| ck->tail_n < 0 || ck->tail_n > PPP_BLOCKSIZE ) {
+		fprintf(stderr, "\n %s: not a checkpoint.", ckpt_name );
+		fclose( fp );
+		return NULL;
+	}
+	return fp;
+}
+
+/* Continues from a checkpoint: the options must give the same header
+	(ckpt.hdr, just made), and the input the same last block. From a
+	done state (--append) the input is new; the tail goes first.
+*/
+int resume_checkpoint( FILE *fp, ckpt_stamp *ck, unsigned char w[], unsigned char p[] )
+{
+	if ( ck->wbits != ppp_WBITS || ck->hdrsize != ckpt.hdrsize
+		|| memcmp( ck->hdr, ckpt.hdr, ckpt.hdrsize ) ) {
+		fprintf(stderr, "\n %s: made with other options.", ckpt_name );
+		return 0;
+	}
+	seek_max = seek_n = ck->seek_n;
+	if ( seek_n && !(seek_table = (seek_entry *) malloc( sizeof(seek_entry) * seek_n )) ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		return 0;
+	}
+	if ( (seek_n && fread( seek_table, sizeof(seek_entry) * seek_n, 1, fp ) != 1)
+		|| (ppp_stride && fread( rec_hist, ppp_stride, 1, fp ) != 1)
+		|| !ckpt_get( fp, w, ppp_WSIZE ) || ck->tail_n >= ppp_blocksize
+		|| (ck->tail_n && (!(ppp_tail = (unsigned char *) malloc( ck->tail_n ))
+		|| fread( ppp_tail, ck->tail_n, 1, fp ) != 1)) ) {
+		fprintf(stderr, "\n %s: truncated or corrupt.", ckpt_name );
+		return 0;
+	}
+	ppp_tail_n = ck->tail_n;
+	if ( ck->done ) ;
+	else if ( ck->last_n != ppp_blocksize || ck->in_offset < ck->last_n
+		|| gt_fseek( gIN, ck->in_offset - ck->last_n, SEEK_SET )
+		|| fread( p, 1, ck->last_n, gIN ) != (size_t) ck->last_n
+		|| crc32c( 0, p, ck->last_n ) != ck->last_crc ) {
+		fprintf(stderr, "\n %s: the input differs from the checkpointed run.", ckpt_name );
+		return 0;
+	}
+	nbytes_out = ck->out_size;
+	nbytes_read = ck->in_offset;
+	ppp_prev = ck->prev;
+	ppp_crc = ck->crc;
+	ppp_phase = ck->phase;
+	store_raw = ck->store_raw;
+	memcpy( filter_count, ck->filter_count, sizeof(filter_count) );
+	ckpt.nblocks = ck->nblocks;
+	if ( ppp_ckpt ) ppp_ckpt_next = (nbytes_read / ppp_ckpt + 1) * ppp_ckpt;
+	return 1;
+}
+
+/* the 1 bits of x, summed per byte and then across (SWAR). */
+static inline int bit_count( uint64_t x )
+{
+	x -= (x >> 1) & 0x5555555555555555ULL;
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+/* the number of literals of a block: its 0 flag bits, 8 flag bytes
+	at a time.
+*/
+int count_literals( unsigned char *flags, int n )
+{
+	uint64_t x;
+	int i = 0, lits = n;
+	
+	for ( ; i + 8 <= n/8; i += 8 ) {
+		memcpy( &x, flags + i, 8 );
+		lits -= bit_count( x );
+	}
+	for ( ; i < n/8; i++ ) lits -= bit_count( flags[i] );
+	if ( n%8 ) lits -= bit_count( flags[i] & ((1<<(n%8))-1) );
+	return lits;
+}
+
+/* PPP_LZ: reads the block's literals into the end of out[]; the merge
+	with the predicted bytes never writes past the next literal.
+*/
+unsigned char *get_literals( unsigned char *flags, unsigned char *out, int n )
+{
+	return read_literals( out, n, count_literals( flags, n ) );
+}
+
+/* the lits literal bytes, into the end of out[n]. */
+unsigned char *read_literals( unsigned char *out, int n, int lits )
+{
+	int c;
+	uint32_t k;
+	unsigned char *lit = out + n - lits;
+	
+	c = gfgetc();
+	if ( c == 1 ) {
+		get_le32( &k );
+		if ( k > (uint32_t) LZ_MAXOUT( ppp_blocksize ) ) k = 0;
+		gb_read( lzbuf, k );
+		if ( !lz_decompress( lzbuf, lzbuf + k, lit, lits ) ) {
+			fprintf(stderr, "\n corrupt LZ literals.");
+			ppp_errors++;
+			memset( lit, 0, lits );
+		}
+	}
+	else gb_read( lit, lits );
+	return lit;
+}
+
+/* decodes one block of n bytes into out[]. Instantiated with constant
+	hash, literal source and table mask (see decode_plain()); the get
+	buffer pointers are kept in locals, as the table stores could
+	otherwise alias them.
+*/
+PPP_INLINE void decode_block_h( unsigned char w[], unsigned char *out, int n,
+	const int hash, const int lz, const int64_t wmask, const int tagged )
+{
+	int c = 0, i = 0, bit = 0;
+	int64_t prev = ppp_prev;  /* prev = context hash */
+	unsigned char *gbstart, *lit = NULL, *g, *gend;
+	uint16_t *tags = ppp_tags, epoch = ppp_epoch;
+	
+	gb_read( gbits, (n+7)/8 );  /* get block of bits */
+	if ( lz ) lit = get_literals( gbits, out, n );
+	gbstart = gbits;
+	g = gbuf, gend = gbuf_end;
+	for ( i = 0; i < n; i++ ){
+		if ( tagged && tags[ prev >> TAG_BITS ] != epoch ) tag_line( w, prev );
+		if ( (*gbstart) & (1<<(bit++)) ) { /* test bit */
+			*out++ = c = w[prev];
+		}
+		else {
+			if ( lz ) c = *lit++;
+			else {
+				c = *g++;  /* get byte */
+				if ( g == gend ) {
+					gbuf = g;
+					gbuf_refill();
+					g = gbuf, gend = gbuf_end;
+				}
+			}
+			*out++ = w[prev] = c;
+		}
+		prev = PPP_HASH( prev, c, hash ) & wmask;
+		if ( bit == 8 ) {
+			bit = 0;
+			++gbstart;
+		}
+	}
+	gbuf = g;
+	ppp_prev = prev;
+}
+
+/* one instance per table size and hash, for the plain LZPGT formats. */
+#define DECODE_WBITS( b, h )  case b: decode_block_h( w, out, n, h, 0, ((int64_t) 1<<(b))-1, 0 ); break;
+#define DECODE_ALL( h ) \
+	switch ( ppp_WBITS ) { \
+		DECODE_WBITS( 15, h ) DECODE_WBITS( 16, h ) DECODE_WBITS( 17, h ) DECODE_WBITS( 18, h ) \
+		DECODE_WBITS( 19, h ) DECODE_WBITS( 20, h ) DECODE_WBITS( 21, h ) DECODE_WBITS( 22, h ) \
+		DECODE_WBITS( 23, h ) DECODE_WBITS( 24, h ) DECODE_WBITS( 25, h ) DECODE_WBITS( 26, h ) \
+		DECODE_WBITS( 27, h ) DECODE_WBITS( 28, h ) DECODE_WBITS( 29, h ) DECODE_WBITS( 30, h ) \
+		default: decode_block_h( w, out, n, h, 0, ppp_WMASK, 0 ); \
+	}
+
+void decode_plain( unsigned char w[], unsigned char *out, int n )
+{
+	if ( ppp_tags ) {
+		if ( ppp_hash == HASH_XOR ) decode_block_h( w, out, n, HASH_XOR, 0, ppp_WMASK, 1 );
+		else decode_block_h( w, out, n, HASH_ADD, 0, ppp_WMASK, 1 );
+	}
+	else if ( ppp_hash == HASH_XOR ) DECODE_ALL( HASH_XOR )
+	else DECODE_ALL( HASH_ADD )
+}
+
+#define MODEL_DECODE( h ) \
+	if ( lz ) decode_block_h( t->w, out, n, h, 1, ppp_WMASK, 0 ); \
+	else decode_block_h( t->w, out, n, h, 0, ppp_WMASK, 0 );
+
+/* PPP_MODELS: the block's model decodes it, the others learn it. */
+void decode_model( unsigned char *out, int n )
+{
+	int m = gfgetc(), lz = fext.ppp_flags & PPP_LZ;
+	model_trial *t;
+	
+	if ( m < 0 || m >= mdl.n ) {
+		fprintf(stderr, "\n bad block model %d.", m );
+		ppp_errors++;
+		m = 0;
+	}
+	t = &mdl.t[m];
+	ppp_prev = t->prev;
+	switch ( ppp_models[m].hash ) {
+		case HASH_XOR:  MODEL_DECODE( HASH_XOR ) break;
+		case HASH_ADD6: MODEL_DECODE( HASH_ADD6 ) break;
+		case HASH_XOR3: MODEL_DECODE( HASH_XOR3 ) break;
+		default:        MODEL_DECODE( HASH_ADD )
+	}
+	t->prev = ppp_prev;
+	mdl.p = out, mdl.len = n, mdl.win = m;
+	models_run( MODEL_UPDATE );
+}
+
+/* a block, or a part, of type c. */
+void decode_part( unsigned char w[], unsigned char *out, int n, int c )
+{
+	if ( c == BLOCK_STORED ) {
+		get_stored( w, out, n );
+		return;
+	}
+	if ( c == BLOCK_RAW ) {
+		gb_read( out, n );
+		learn_raw( w, out, n );
+		return;
+	}
+	if ( c == BLOCK_RUN ) {
+		if ( (c = gfgetc()) == EOF ) c = 0;
+		memset( out, c, n );
+		skip_block( out, n );
+		return;
+	}
+	if ( ppp_stride ) decode_stride( w, out, n );
+	else if ( ppp_word == 2 ) decode_words_h( w, out, n, 2 );
+	else if ( ppp_word == 4 ) decode_words_h( w, out, n, 4 );
+	else if ( ppp_word == 8 ) decode_words_h( w, out, n, 8 );
+	else if ( fext.ppp_flags & PPP_MODELS ) decode_model( out, n );
+	else if ( fext.ppp_flags & PPP_LZ ) {
+		if ( ppp_hash == HASH_XOR ) decode_block_h( w, out, n, HASH_XOR, 1, ppp_WMASK, 0 );
+		else decode_block_h( w, out, n, HASH_ADD, 1, ppp_WMASK, 0 );
+	}
+	else decode_plain( w, out, n );
+}
+
+void decode_typed( unsigned char w[], unsigned char *out, int n )
+{
+	uint32_t len;
+	int i, c = BLOCK_CODED;
+	
+	if ( fext.ppp_flags & PPP_STORED ) c = gfgetc();
+	if ( c != BLOCK_SPLIT ) {
+		decode_part( w, out, n, c );
+		return;
+	}
+	for ( i = 0; i < n; i += len ) {
+		if ( !get_le32( &len ) || len == 0 || len > (uint32_t) (n - i)
+			|| (c = gfgetc()) == BLOCK_SPLIT ) {
+			fprintf(stderr, "\n bad split block.");
+			ppp_errors++;
+			memset( out + i, 0, n - i );
+			return;
+		}
+		decode_part( w, out + i, (int) len, c );
+	}
+}
+
+void decode_block( unsigned char w[], unsigned char *out, int n )
+{
+	int id = FILTER_NONE;
+	
+	if ( fext.ppp_flags & PPP_FILTER ) id = gfgetc();
+	decode_typed( w, out, n );
+	if ( !filter_inv( id, out, n ) ) {
+		fprintf(stderr, "\n bad filter id %d.", id );
+		ppp_errors++;
+	}
+}
+
+void put_out( unsigned char *p, int n );
+
+/* writes a decoded block, unless we only need the table state. */
+void put_block( unsigned char *p, int n )
+{
+	if ( fext.ppp_flags & PPP_DEDUP ) {
+		dedup_put( p, n );
+		return;
+	}
+	put_out( p, n );
+}
+
+/* writes n bytes of output; with ppp_discard only counts them. */
+void put_out( unsigned char *p, int n )
+{
+	nbytes_out += n;
+	if ( ppp_discard ) return;
+	if ( ppp_sparse && n && !p[0] && is_run( p, n ) && !gt_fseek( pOUT, n, SEEK_CUR ) ) {
+		ppp_hole_end = 1;
+		return;
+	}
+	ppp_hole_end = 0;
+	pfwrite( p, n );
+}
+
+void decompress_LZP( unsigned char w[] )
+{
+	int64_t b = 0;
+	
+	if ( ppp_nblocks > 0 ) while ( ppp_nblocks-- ) {
+		restart_block( w, b, 0 );
+		decode_block( w, pattern, ppp_blocksize );
+		check_block( pattern, ppp_blocksize, b++ );
+		put_block( pattern, ppp_blocksize );
+	}
+	
+	/* last block */
+	if ( ppp_lastblocksize > 0 ) {
+		restart_block( w, b, 0 );
+		decode_block( w, pattern, ppp_lastblocksize );
+		check_block( pattern, ppp_lastblocksize, b );
+		put_block( pattern, ppp_lastblocksize );
+	}
+}
+
+/* reads the seek table from the end of the file; 0 if there is none. */
+int load_seek_table( void )
+{
+	seek_footer sf;
+	
+	if ( !(fext.ppp_flags & PPP_RESTART) ) return 0;
+	if ( gt_fseek( gIN, -(int64_t) sizeof(seek_footer), SEEK_END )
+		|| fread( &sf, sizeof(seek_footer), 1, gIN ) != 1
+		|| strcmp( sf.magic, "LZPGTSK" ) || sf.nentries <= 0 ) return 0;
+	seek_table = (seek_entry *) malloc( sizeof(seek_entry) * sf.nentries );
+	if ( !seek_table ) return 0;
+	gt_fseek( gIN, sf.table_offset, SEEK_SET );
+	seek_n = fread( seek_table, sizeof(seek_entry), sf.nentries, gIN );
+	seek_end = sf.table_offset;
+	return seek_n > 0;
+}
+
+/* Random access: decodes len bytes from uncompressed offset off.
+	With a seek table this starts at the nearest restart point at or
+	before off, so the cost is at most one restart interval plus len;
+	without one, everything before off is decoded and discarded.
+*/
+int64_t decompress_range( unsigned char w[], int64_t off, int64_t len )
+{
+	int64_t b, nb, bstart, total, end, s, e, coffset, i;
+	int n;
+	
+	nb = ppp_nblocks + (ppp_lastblocksize > 0);
+	total = ppp_nblocks * ppp_blocksize + ppp_lastblocksize;
+	if ( off > total ) off = total;
+	end = (len > total - off) ? total : off + len;
+	
+	b = 0;
+	coffset = ppp_hdrsize;
+	if ( load_seek_table() ) {
+		for ( i = 0; i < seek_n && seek_table[i].uoffset <= off; i++ ) {
+			b = seek_table[i].uoffset / ppp_blocksize;
+			coffset = seek_table[i].coffset;
+		}
+	}
+	seek_get_buffer( coffset );
+	reset_table( w );
+	
+	for ( ; b < nb && (bstart = b * ppp_blocksize) < end; b++ ) {
+		n = (b < ppp_nblocks) ? ppp_blocksize : ppp_lastblocksize;
+		restart_block( w, b, 0 );
+		decode_block( w, pattern, n );
+		check_block( pattern, n, b );
+		s = (off > bstart) ? off : bstart;
+		e = (end < bstart+n) ? end : bstart+n;
+		if ( s < e ) put_block( pattern + (s-bstart), (int) (e-s) );
+	}
+	return end - off;
+}
+
+/* ---- Frames (PPP_SIZED) ----
+	A frame is a whole file made with c --frame or --range; its size
+	follows the header. Frames joined end to end decode to their
+	inputs joined: each from a fresh table, with the settings of the
+	first. Only the counts, the stream hash and the size may differ.
+*/
+
+/* the header as written: file stamp, extension and the fields after it. */
+int make_header( unsigned char *h, file_stamp *fs )
+{
+	int i, n = sizeof(file_stamp);
+	
+	memcpy( h, fs, n );
+	if ( strcmp( fs->alg, "LZPGT8" ) ) return n;
+	memcpy( h + n, &fext, sizeof(file_stamp_ext) );
+	n += sizeof(file_stamp_ext);
+	if ( fext.ppp_flags & PPP_MODELS ) h[ n++ ] = mdl.n;
+	if ( fext.ppp_flags & PPP_STRIDE ) {
+		for ( i = 0; i < 4; i++ ) h[ n++ ] = (unsigned char) (ppp_stride >> (8*i));
+	}
+	if ( fext.ppp_flags & PPP_SIZED ) {   /* the frame size, rewritten at the end. */
+		memset( h + n, 0, 8 );
+		n += 8;
+	}
+	return n;
+}
+
+/* clears a frame header's own fields: what is left are the settings. */
+void frame_key( unsigned char *h, int n )
+{
+	memset( h + offsetof( file_stamp, ppp_nblocks ), 0, sizeof(int64_t) );
+	memset( h + offsetof( file_stamp, ppp_lastblocksize ), 0, sizeof(int) );
+	memset( h + sizeof(file_stamp) + offsetof( file_stamp_ext, ppp_crc ), 0, sizeof(uint32_t) );
+	memset( h + n - 8, 0, 8 );
+}
+
+/* the length of a frame header from its stamp and extension; 0: not a frame. */
+int frame_hdrsize( const unsigned char *h )
+{
+	file_stamp_ext e;
+	
+	if ( memcmp( h, "LZPGT8", 7 ) ) return 0;
+	memcpy( &e, h + sizeof(file_stamp), sizeof(e) );
+	if ( !(e.ppp_flags & PPP_SIZED) || (e.ppp_flags & PPP_STREAM) ) return 0;
+	return (int) (sizeof(file_stamp) + sizeof(e)) + ((e.ppp_flags & PPP_MODELS) ? 1 : 0)
+		+ ((e.ppp_flags & PPP_STRIDE) ? 4 : 0) + 8;
+}
+
+int64_t frame_len( const unsigned char *h, int n )
+{
+	int64_t v = 0;
+	int i;
+	
+	for ( i = 0; i < 8; i++ ) v |= (int64_t) h[n-8+i] << (8*i);
+	return v;
+}
+
+/* skips to the next frame and reads its header; 0 at the end. */
+int next_frame( unsigned char w[] )
+{
+	unsigned char h[ CKPT_HDRMAX ];
+	file_stamp fs;
+	file_stamp_ext fe;
+	int64_t skip = frame_off + frame_size - (nbytes_read + (gbuf - gbuf_start));
+	int i, c = 0, n = ppp_hdrsize;
+	
+	if ( skip < 0 ) {
+		fprintf(stderr, "\n frame at %lld: bad size.", (long long) frame_off );
+		ppp_errors++;
+		return 0;
+	}
+	while ( skip-- > 0 && gfgetc() != EOF ) ;  /* the seek table */
+	frame_off += frame_size;
+	for ( i = 0; i < n && (c = gfgetc()) != EOF; i++ ) h[i] = (unsigned char) c;
+	if ( i == 0 ) return 0;
+	memset( h + i, 0, n - i );
+	frame_size = frame_len( h, n );
+	memcpy( &fs, h, sizeof(fs) );
+	memcpy( &fe, h + sizeof(fs), sizeof(fe) );
+	frame_key( h, n );
+	if ( i < n || memcmp( h, frame_hdr, n ) || frame_size < n ) {
+		fprintf(stderr, "\n frame at %lld: not a frame like the first.", (long long) frame_off );
+		ppp_errors++;
+		return 0;
+	}
+	ppp_nblocks = fs.ppp_nblocks;
+	ppp_lastblocksize = fs.ppp_lastblocksize;
+	fext.ppp_crc = fe.ppp_crc;
+	reset_table( w );
+	if ( fext.ppp_flags & PPP_MODELS ) models_reset();
+	if ( ppp_stride ) stride_reset( 0 );
+	ppp_prev = 0;
+	ppp_crc = 0;
+	return 1;
+}
+
+/* Decodes the file: one frame, or with PPP_SIZED every frame joined
+	to it. Returns the bytes decoded.
+*/
+int64_t decompress_frames( unsigned char w[] )
+{
+	int64_t total = 0;
+	
+	do {
+		total += ppp_nblocks * ppp_blocksize + ppp_lastblocksize;
+		decompress_LZP( w );
+		check_stream();
+	} while ( (fext.ppp_flags & PPP_SIZED) && next_frame( w ) );
+	return total;
+}
+
+/* cat: joins the frames of the named files. Each file is walked by
+	its frame headers only, checked, then copied as it is: no payload
+	byte is read by the coder or written again.
+*/
+int cat_frames( char *outname, char *names[], int n )
+{
+	unsigned char h[ CKPT_HDRMAX ], first[ CKPT_HDRMAX ], *buf;
+	const int hs = sizeof(file_stamp) + sizeof(file_stamp_ext);
+	int k, len, len0 = 0, ok = 1;
+	int64_t off, size, nframes = 0, total = 0;
+	struct stat st;
+	FILE *fp, *out;
+	size_t r;
+	
+	for ( k = 0; k < n && ok; k++ ) {
+		if ( (fp = fopen( names[k], "rb" )) == NULL || fstat( fileno( fp ), &st ) ) {
+			fprintf(stderr, "\n Error opening %s.", names[k] );
+			if ( fp ) fclose( fp );
+			return 0;
+		}
+		for ( off = 0; off < st.st_size && ok; off += size, nframes++ ) {
+			ok = gt_fseek( fp, off, SEEK_SET ) == 0 && fread( h, hs, 1, fp ) == 1
+				&& (len = frame_hdrsize( h )) > 0 && fread( h + hs, len - hs, 1, fp ) == 1;
+			if ( !ok ) {
+				fprintf(stderr, "\n %s at %lld: not a frame (c --frame).", names[k], (long long) off );
+				break;
+			}
+			size = frame_len( h, len );
+			frame_key( h, len );
+			if ( !len0 ) memcpy( first, h, len0 = len );
+			if ( len != len0 || memcmp( h, first, len ) ) {
+				fprintf(stderr, "\n %s at %lld: made with other settings.", names[k], (long long) off );
+				ok = 0;
+			}
+			else if ( size < len || size > st.st_size - off ) {
+				fprintf(stderr, "\n %s at %lld: bad frame size.", names[k], (long long) off );
+				ok = 0;
+			}
+		}
+		total += st.st_size;
+		fclose( fp );
+	}
+	if ( !ok ) return 0;
+	
+	out = strcmp( outname, "-" ) ? fopen( outname, "wb" ) : stdout;
+	buf = (unsigned char *) malloc( PPP_BLOCKSIZE );
+	if ( !out || !buf ) {
+		fprintf(stderr, "\n Error opening %s.", outname );
+		free( buf );
+		return 0;
+	}
+	for ( k = 0; k < n && ok; k++ ) {
+		if ( (fp = fopen( names[k], "rb" )) == NULL ) ok = 0;
+		else {
+			while ( (r = fread( buf, 1, PPP_BLOCKSIZE, fp )) > 0 )
+				if ( fwrite( buf, 1, r, out ) != r ) ok = 0;
+			fclose( fp );
+		}
+	}
+	if ( out != stdout && fclose( out ) ) ok = 0;
+	free( buf );
+	if ( !ok ) fprintf(stderr, "\n Error writing %s.", outname );
+	else fprintf(stderr, "\n %lld frames, %lld bytes -> %s", (long long) nframes, (long long) total, outname );
+	return ok;
+}
+
+/* ---- Dedup ---- */
+
+uint64_t dd_hash( unsigned char *p, int n )
+{
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ (uint64_t) n, x;
+	int i;
+	
+	for ( i = 0; i + 8 <= n; i += 8 ) {
+		memcpy( &x, p+i, 8 );
+		h = (h ^ x) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+	}
+	for ( ; i < n; i++ ) h = (h ^ p[i]) * 0x100000001b3ULL;
+	h ^= h >> 29;
+	return h ? h : 1;
+}
+
+int dd_init( void )
+{
+	uint64_t x = 0x853c49e6748fea9bULL;
+	int i;
+	
+	for ( i = 0; i < 256; i++ ) {  /* splitmix64 */
+		x += 0x9e3779b97f4a7c15ULL;
+		dd.gear[i] = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		dd.gear[i] ^= dd.gear[i] >> 27;
+	}
+	dd.in = (unsigned char *) malloc( 2*DD_MAXCHUNK );
+	dd.q = (unsigned char *) malloc( ppp_blocksize + 2*DD_MAXCHUNK );
+	dd.tab_size = 1<<16;
+	dd.tab = (dd_entry *) calloc( dd.tab_size, sizeof(dd_entry) );
+	dd.lit_hdr = -1;
+	return dd.in && dd.q && dd.tab;
+}
+
+void dedup_free( void )
+{
+	free( dd.in ); free( dd.q ); free( dd.tab ); free( dd.copy );
+	memset( &dd, 0, sizeof(dd) );
+}
+
+/* finds the chunk, or adds it and returns NULL. */
+dd_entry *dd_lookup( unsigned char *p, int n, int64_t offset )
+{
+	uint64_t h = dd_hash( p, n );
+	uint32_t crc = crc32c( 0, p, n );
+	dd_entry *e, *old;
+	int64_t i, k;
+	
+	if ( 2*(dd.tab_n+1) > dd.tab_size ) {  /* grow, rehash */
+		old = dd.tab;
+		k = dd.tab_size;
+		dd.tab_size *= 2;
+		dd.tab = (dd_entry *) calloc( dd.tab_size, sizeof(dd_entry) );
+		if ( !dd.tab ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+		for ( i = 0; i < k; i++ ) if ( old[i].h ) {
+			e = &dd.tab[ old[i].h & (dd.tab_size-1) ];
+			while ( e->h ) e = (e == dd.tab + dd.tab_size-1) ? dd.tab : e+1;
+			*e = old[i];
+		}
+		free( old );
+	}
+	e = &dd.tab[ h & (dd.tab_size-1) ];
+	while ( e->h ) {
+		if ( e->h == h && e->crc == crc && e->len == (uint32_t) n ) return e;
+		e = (e == dd.tab + dd.tab_size-1) ? dd.tab : e+1;
+	}
+	e->h = h, e->crc = crc, e->len = n, e->offset = offset;
+	dd.tab_n++;
+	return NULL;
+}
+
+void dd_put32( unsigned char *p, uint32_t v )
+{
+	p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+/* cuts the next chunk from the input window; returns its size. */
+int dd_chunk( void )
+{
+	unsigned char *p = dd.in + dd.in_pos;
+	int i, n = dd.in_end - dd.in_pos;
+	uint64_t h = 0, mask = ((uint64_t) 1 << DD_AVGBITS) - 1;
+	
+	if ( n <= DD_MINCHUNK ) return n;
+	if ( n > DD_MAXCHUNK ) n = DD_MAXCHUNK;
+	for ( i = DD_MINCHUNK - 64; i < DD_MINCHUNK; i++ ) h = (h << 1) + dd.gear[ p[i] ];
+	for ( ; i < n; i++ ) {
+		h = (h << 1) + dd.gear[ p[i] ];
+		if ( !(h >> (64 - DD_AVGBITS) & mask) ) return i + 1;
+	}
+	return n;
+}
+
+/* appends the next chunk's records to dd.q. */
+void dd_next( void )
+{
+	int n, k;
+	dd_entry *e;
+	
+	if ( !dd.eof && dd.in_end - dd.in_pos < DD_MAXCHUNK ) {
+		memmove( dd.in, dd.in + dd.in_pos, dd.in_end - dd.in_pos );
+		dd.in_end -= dd.in_pos, dd.in_pos = 0;
+		k = (int) fread( dd.in + dd.in_end, 1, 2*DD_MAXCHUNK - dd.in_end, gIN );
+		if ( k == 0 ) dd.eof = 1;
+		dd.in_end += k;
+	}
+	if ( (n = dd_chunk()) == 0 ) return;
+	if ( (e = dd_lookup( dd.in + dd.in_pos, n, dd.in_bytes )) != NULL ) {
+		dd.lit_hdr = -1;
+		dd.q[dd.q_end] = 'R';
+		dd_put32( dd.q + dd.q_end + 1, n );
+		dd_put32( dd.q + dd.q_end + 5, (uint32_t) e->offset );
+		dd_put32( dd.q + dd.q_end + 9, (uint32_t) (e->offset >> 32) );
+		dd.q_end += 13;
+		dd.dup_bytes += n;
+	}
+	else {
+		if ( dd.lit_hdr < 0 ) {
+			dd.lit_hdr = dd.q_end;
+			dd.q[dd.q_end] = 'L';
+			dd_put32( dd.q + dd.q_end + 1, 0 );
+			dd.q_end += 5;
+		}
+		memcpy( dd.q + dd.q_end, dd.in + dd.in_pos, n );
+		dd.q_end += n;
+		k = dd.q_end - dd.lit_hdr - 5;
+		dd_put32( dd.q + dd.lit_hdr + 1, k );
+		if ( k >= DD_MAXLIT ) dd.lit_hdr = -1;
+	}
+	dd.in_pos += n;
+	dd.in_bytes += n;
+}
+
+/* fills p[] with up to n bytes of the record stream (n unless at EOF).
+	An 'L' record is closed once its first bytes are given out.
+*/
+int dedup_read( unsigned char *p, int n )
+{
+	int k, got = 0;
+	
+	if ( !dd.in && !dd_init() ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		exit(0);
+	}
+	while ( got < n ) {
+		if ( dd.q_end - dd.q_pos < n - got && !(dd.eof && dd.in_pos == dd.in_end) ) {
+			if ( dd.q_pos ) {
+				memmove( dd.q, dd.q + dd.q_pos, dd.q_end - dd.q_pos );
+				if ( dd.lit_hdr >= 0 ) dd.lit_hdr -= dd.q_pos;
+				dd.q_end -= dd.q_pos, dd.q_pos = 0;
+			}
+			dd_next();
+			continue;
+		}
+		if ( dd.q_pos == dd.q_end ) break;
+		dd.lit_hdr = -1;
+		k = dd.q_end - dd.q_pos < n - got ? dd.q_end - dd.q_pos : n - got;
+		memcpy( p + got, dd.q + dd.q_pos, k );
+		dd.q_pos += k, got += k;
+	}
+	return got;
+}
+
+/* copies len bytes of earlier output, from offset. */
+void dd_copy( int64_t offset, uint32_t len )
+{
+	int m;
+#if defined( __unix__ ) || defined( __APPLE__ )
+	ssize_t r;
+	
+	if ( offset < 0 || offset + len > nbytes_out || pOUT_direct ) {
+		fprintf(stderr, "\n bad dedup reference.");
+		ppp_errors++;
+		return;
+	}
+	if ( ppp_discard ) {  /* t: the reference checked, the size counted. */
+		nbytes_out += len;
+		return;
+	}
+	if ( !dd.copy && !(dd.copy = (unsigned char *) malloc( DD_MAXCHUNK )) ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		exit(0);
+	}
+	fflush( pOUT );
+	while ( len ) {
+		m = len < DD_MAXCHUNK ? len : DD_MAXCHUNK;
+		r = pread( fileno( pOUT ), dd.copy, m, offset );
+		if ( r < 0 ) {
+			fprintf(stderr, "\n dedup needs a seekable output file.");
+			ppp_errors++;
+			exit(1);
+		}
+		if ( r < m ) memset( dd.copy + r, 0, m - r );  /* a trailing hole (--sparse) */
+		put_out( dd.copy, m );
+		offset += m, len -= m;
+	}
+#else
+	(void) offset; (void) len; (void) m;
+	fprintf(stderr, "\n dedup files are not supported here.");
+	ppp_errors++;
+#endif
+}
+
+/* parses the record stream of decoded blocks; writes the output. */
+void dedup_put( unsigned char *p, int n )
+{
+	uint32_t len;
+	int k;
+	
+	while ( n > 0 ) {
+		if ( dd.lit_left ) {
+			k = dd.lit_left < (uint32_t) n ? (int) dd.lit_left : n;
+			put_out( p, k );
+			p += k, n -= k, dd.lit_left -= k;
+			continue;
+		}
+		if ( dd.hdr_n == 0 ) {
+			dd.hdr_len = (*p == 'L') ? 5 : (*p == 'R') ? 13 : 0;
+			if ( !dd.hdr_len ) {
+				fprintf(stderr, "\n bad dedup record.");
+				ppp_errors++;
+				return;
+			}
+		}
+		dd.hdr[ dd.hdr_n++ ] = *p++, n--;
+		if ( dd.hdr_n < dd.hdr_len ) continue;
+		dd.hdr_n = 0;
+		len = dd.hdr[1] | dd.hdr[2] << 8 | dd.hdr[3] << 16 | (uint32_t) dd.hdr[4] << 24;
+		if ( dd.hdr[0] == 'L' ) dd.lit_left = len;
+		else dd_copy( (int64_t) (dd.hdr[5] | dd.hdr[6] << 8 | dd.hdr[7] << 16 | (uint32_t) dd.hdr[8] << 24)
+			| (int64_t) (dd.hdr[9] | dd.hdr[10] << 8 | dd.hdr[11] << 16 | (uint32_t) dd.hdr[12] << 24) << 32, len );
+	}
+}
+
+/* ---- Streaming ---- */
+
+/* 32-bit LE values in the coded stream, at a byte boundary. */
+void put_le32( uint32_t v )
+{
+	pfputc( v & 0xff ); pfputc( (v >> 8) & 0xff );
+	pfputc( (v >> 16) & 0xff ); pfputc( (v >> 24) & 0xff );
+}
+
+/* returns 0 on EOF; a truncated value reads as zero bytes. */
+int get_le32( uint32_t *v )
+{
+	int i, c, ok = 1;
+	
+	for ( i = 0, *v = 0; i < 4; i++ ) {
+		if ( (c = gfgetc()) == EOF ) c = 0, ok = 0;
+		*v |= (uint32_t) c << (8*i);
+	}
+	return ok;
+}
+
+/* end-of-stream marker and trailer. */
+void put_trailer( void )
+{
+	stream_trailer st;
+	unsigned char *b = (unsigned char *) &st;
+	unsigned int i;
+	
+	memset( &st, 0, sizeof(st) );
+	st.ppp_nblocks = ppp_nblocks;
+	st.ppp_lastblocksize = ppp_lastblocksize;
+	st.ppp_crc = ppp_crc;
+	put_le32( 0 );
+	for ( i = 0; i < sizeof(st); i++ ) pfputc( b[i] );
+}
+
+/* Decodes a PPP_STREAM file up to its end marker, writing the bytes in
+	[off, off+len) (len < 0: to the end); the block count and sizes are
+	checked against the trailer. Sets ppp_nblocks, ppp_lastblocksize.
+*/
+int64_t decompress_stream( unsigned char w[], int64_t off, int64_t len )
+{
+	stream_trailer st;
+	unsigned char *b = (unsigned char *) &st;
+	int64_t bstart = 0, end, s, e;
+	uint32_t n;
+	unsigned int i;
+	int c;
+	
+	end = (len < 0) ? INT64_MAX : off + len;
+	ppp_nblocks = 0;
+	ppp_lastblocksize = 0;
+	while ( 1 ) {
+		if ( !get_le32( &n ) ) {
+			fprintf(stderr, "\n unexpected end of stream.");
+			ppp_errors++;
+			return bstart;
+		}
+		if ( n == 0 ) break;
+		if ( n > (uint32_t) ppp_blocksize || (ppp_lastblocksize && !(fext.ppp_flags & PPP_FRAMES)) ) {
+			fprintf(stderr, "\n block %lld: bad block size.", (long long) ppp_nblocks );
+			ppp_errors++;
+			return bstart;
+		}
+		decode_block( w, pattern, n );
+		if ( ppp_eof_fill > 1 || (ppp_eof_fill && gbuf != gbuf_start) ) {
+			/* a frame still being written, or a cut file. */
+			fprintf(stderr, "\n incomplete block at %lld bytes: the stream ends there.",
+				(long long) bstart );
+			ppp_errors++;
+			ppp_eof_fill = 0;
+			return bstart;
+		}
+		check_block( pattern, n, ppp_nblocks );
+		s = (off > bstart) ? off : bstart;
+		e = (end < bstart+n) ? end : bstart+n;
+		if ( s < e ) put_block( pattern + (s-bstart), (int) (e-s) );
+		bstart += n;
+		if ( n == (uint32_t) ppp_blocksize ) ppp_nblocks++;
+		else ppp_lastblocksize = n;
+	}
+	if ( fext.ppp_flags & PPP_FRAMES ) {
+		ppp_nblocks = bstart / ppp_blocksize;
+		ppp_lastblocksize = (int) (bstart % ppp_blocksize);
+	}
+	for ( i = 0; i < sizeof(st); i++ ) {
+		if ( (c = gfgetc()) == EOF ) break;
+		b[i] = c;
+	}
+	if ( i < sizeof(st) || st.ppp_nblocks != ppp_nblocks
+		|| st.ppp_lastblocksize != ppp_lastblocksize ) {
+		fprintf(stderr, "\n bad stream trailer.");
+		ppp_errors++;
+	}
+	fext.ppp_crc = st.ppp_crc;
+	return bstart;
+}
+
+/* ---- Checksums ---- */
+
+void put_checksum( unsigned char *p, int n )
+{
+	uint32_t crc = crc32c( 0, p, n );
+	unsigned char b[4];
+	
+	b[0] = crc, b[1] = crc >> 8, b[2] = crc >> 16, b[3] = crc >> 24;
+	put_le32( crc );
+	ppp_crc = crc32c( ppp_crc, b, 4 );
+}
+
+void check_block( unsigned char *p, int n, int64_t blockno )
+{
+	uint32_t crc, stored;
+	unsigned char b[4];
+	
+	if ( !(fext.ppp_flags & PPP_CHECKSUM) ) return;
+	get_le32( &stored );
+	crc = crc32c( 0, p, n );
+	if ( crc != stored ) {
+		fprintf(stderr, "\n block %lld: checksum error.", (long long) blockno );
+		ppp_errors++;
+	}
+	b[0] = crc, b[1] = crc >> 8, b[2] = crc >> 16, b[3] = crc >> 24;
+	ppp_crc = crc32c( ppp_crc, b, 4 );
+}
+
+/* after a full decode: stream hash and truncation. */
+int check_stream( void )
+{
+	if ( ppp_eof_fill > 1 || (ppp_eof_fill && gbuf != gbuf_start) ) {
+		fprintf(stderr, "\n unexpected end of file.");
+		ppp_errors++;
+	}
+	if ( (fext.ppp_flags & PPP_CHECKSUM) && ppp_crc != fext.ppp_crc ) {
+		fprintf(stderr, "\n stream hash mismatch.");
+		ppp_errors++;
+	}
+	return ppp_errors == 0;
+}
+
+/* decodes one block of n bytes from memory; reentrant, for the worker
+	threads. returns the end of the coded block, or NULL if it would
+	read past send.
+*/
+PPP_INLINE unsigned char *decode_mem_h( unsigned char w[], int64_t wmask, int64_t *pprev,
+	unsigned char *src, unsigned char *send, unsigned char *out, int n, const int hash, const int lz )
+{
+	int64_t prev = *pprev;
+	int c, i, nf = (n+7)/8, lits;
+	unsigned char *lit, *end;
+	uint32_t k;
+	
+	if ( send - src < nf ) return NULL;
+	lits = count_literals( src, n );
+	lit = src + nf;
+	if ( lz ) {  /* literals into the end of out[], see get_literals() */
+		if ( lit == send ) return NULL;
+		if ( *lit++ == 1 ) {
+			if ( send - lit < 4 ) return NULL;
+			k = lit[0] | lit[1] << 8 | lit[2] << 16 | (uint32_t) lit[3] << 24;
+			lit += 4;
+			if ( (uint32_t) (send - lit) < k
+				|| !lz_decompress( lit, lit + k, out + n - lits, lits ) ) return NULL;
+			end = lit + k;
+		}
+		else {
+			if ( send - lit < lits ) return NULL;
+			memcpy( out + n - lits, lit, lits );
+			end = lit + lits;
+		}
+		lit = out + n - lits;
+	}
+	else {
+		if ( send - lit < lits ) return NULL;
+		end = lit + lits;
+	}
+	for ( i = 0; i < n; i++ ) {
+		if ( src[i>>3] & (1<<(i&7)) ) c = w[prev];
+		else w[prev] = c = *lit++;
+		out[i] = c;
+		prev = PPP_HASH( prev, c, hash ) & wmask;
+	}
+	*pprev = prev;
+	return end;
+}
+
+unsigned char *decode_mem_typed( unsigned char w[], int64_t wmask, int64_t *pprev,
+	unsigned char *src, unsigned char *send, unsigned char *out, int n )
+{
+	if ( fext.ppp_flags & PPP_STORED ) {
+		if ( src == send ) return NULL;
+		if ( *src == BLOCK_SPLIT ) {
+			uint32_t len;
+			int i;
+			
+			for ( src++, i = 0; i < n; i += len ) {
+				if ( send - src < 5 ) return NULL;
+				len = src[0] | src[1] << 8 | src[2] << 16 | (uint32_t) src[3] << 24;
+				src += 4;
+				if ( len == 0 || len > (uint32_t) (n - i) || *src == BLOCK_SPLIT
+					|| !(src = decode_mem_typed( w, wmask, pprev, src, send, out + i, (int) len )) )
+					return NULL;
+			}
+			return src;
+		}
+		if ( *src == BLOCK_STORED ) {
+			if ( send - ++src < n ) return NULL;
+			memcpy( out, src, n );
+			if ( ppp_hash == HASH_XOR ) count_hits_h( w, out, n, pprev, wmask, HASH_XOR );
+			else count_hits_h( w, out, n, pprev, wmask, HASH_ADD );
+			return src + n;
+		}
+		if ( *src == BLOCK_RAW ) {
+			int m = n < STORE_SAMPLE ? n : STORE_SAMPLE;
+			
+			if ( send - ++src < n ) return NULL;
+			memcpy( out, src, n );
+			if ( ppp_hash == HASH_XOR ) count_hits_h( w, out, m, pprev, wmask, HASH_XOR );
+			else count_hits_h( w, out, m, pprev, wmask, HASH_ADD );
+			*pprev = hash_tail( *pprev, out + m, n - m );
+			return src + n;
+		}
+		if ( *src++ == BLOCK_RUN ) {
+			if ( src == send ) return NULL;
+			memset( out, *src, n );
+			*pprev = hash_tail( *pprev, out, n );
+			return src + 1;
+		}
+	}
+	if ( fext.ppp_flags & PPP_LZ ) {
+		if ( ppp_hash == HASH_XOR ) return decode_mem_h( w, wmask, pprev, src, send, out, n, HASH_XOR, 1 );
+		return decode_mem_h( w, wmask, pprev, src, send, out, n, HASH_ADD, 1 );
+	}
+	if ( ppp_hash == HASH_XOR ) return decode_mem_h( w, wmask, pprev, src, send, out, n, HASH_XOR, 0 );
+	return decode_mem_h( w, wmask, pprev, src, send, out, n, HASH_ADD, 0 );
+}
+
+unsigned char *decode_mem( unsigned char w[], int64_t wmask, int64_t *pprev,
+	unsigned char *src, unsigned char *send, unsigned char *out, int n )
+{
+	int id = FILTER_NONE;
+	
+	if ( fext.ppp_flags & PPP_FILTER ) {
+		if ( src == send ) return NULL;
+		id = *src++;
+	}
+	src = decode_mem_typed( w, wmask, pprev, src, send, out, n );
+	if ( src && !filter_inv( id, out, n ) ) return NULL;
+	return src;
+}
+
+#if defined( PPP_THREADS )
+
+static struct {
+	char *infile;
+	int64_t next, nseg, nb;
+	uint32_t *block_crc;
+	pthread_mutex_t lock;
+} tp;
+
+/* verifies restart segments (independent runs of blocks) until none are left. */
+static void *test_worker( void *arg )
+{
+	FILE *fp;
+	unsigned char *w, *out, *seg = NULL, *src, *send;
+	int64_t i, b, b1, c1, segsize = 0;
+	uint32_t crc, stored;
+	int n, errors = 0;
+	int64_t prev;
+	
+	(void) arg;
+	fp = fopen( tp.infile, "rb" );
+	w = (unsigned char *) malloc( ppp_WSIZE );
+	out = (unsigned char *) malloc( ppp_blocksize );
+	if ( !fp || !w || !out ) {
+		fprintf(stderr, "\n test thread: out of resources.");
+		errors++;
+		goto done;
+	}
+	while ( 1 ) {
+		pthread_mutex_lock( &tp.lock );
+		i = tp.next++;
+		pthread_mutex_unlock( &tp.lock );
+		if ( i >= tp.nseg ) break;
+		
+		b = seek_table[i].uoffset / ppp_blocksize;
+		b1 = (i+1 < tp.nseg) ? seek_table[i+1].uoffset / ppp_blocksize : tp.nb;
+		c1 = (i+1 < tp.nseg) ? seek_table[i+1].coffset : seek_end;
+		if ( c1 - seek_table[i].coffset > segsize ) {
+			segsize = c1 - seek_table[i].coffset;
+			seg = (unsigned char *) realloc( seg, segsize );
+			if ( !seg ) {
+				fprintf(stderr, "\nmemory allocation error!");
+				exit(0);
+			}
+		}
+		gt_fseek( fp, seek_table[i].coffset, SEEK_SET );
+		send = seg + fread( seg, 1, c1 - seek_table[i].coffset, fp );
+		
+		init_table( w );
+		prev = 0;
+		for ( src = seg; b < b1; b++ ) {
+			n = (b < ppp_nblocks) ? ppp_blocksize : ppp_lastblocksize;
+			src = decode_mem( w, ppp_WMASK, &prev, src, send, out, n );
+			if ( src == NULL ) {
+				fprintf(stderr, "\n block %lld: truncated or corrupt.", (long long) b );
+				errors++;
+				break;
+			}
+			if ( fext.ppp_flags & PPP_CHECKSUM ) {
+				if ( send - src < 4 ) {
+					fprintf(stderr, "\n block %lld: truncated.", (long long) b );
+					errors++;
+					break;
+				}
+				stored = src[0] | src[1] << 8 | src[2] << 16 | (uint32_t) src[3] << 24;
+				src += 4;
+				crc = crc32c( 0, out, n );
+				tp.block_crc[b] = crc;
+				if ( crc != stored ) {
+					fprintf(stderr, "\n block %lld: checksum error.", (long long) b );
+					errors++;
+				}
+			}
+		}
+		if ( src && src != send ) {
+			fprintf(stderr, "\n segment %lld: size mismatch.", (long long) i );
+			errors++;
+		}
+	}
+	
+	done:
+	pthread_mutex_lock( &tp.lock );
+	ppp_errors += errors;
+	pthread_mutex_unlock( &tp.lock );
+	if ( fp ) fclose( fp );
+	free( w ); free( out ); free( seg );
+	return NULL;
+}
+#endif
+
+/* Test a file with restart points on several threads. Returns 0 when
+	the file has no seek table (or no threads), to test sequentially.
+*/
+int test_parallel( char *infile )
+{
+#if defined( PPP_THREADS )
+	pthread_t *th;
+	unsigned char b[4];
+	int64_t i;
+	int t, nt = ppp_nthreads;
+	
+	if ( nt <= 0 ) nt = (int) sysconf( _SC_NPROCESSORS_ONLN );
+	if ( fext.ppp_flags & PPP_MODELS ) return 0;  /* the segments need every model. */
+	if ( ppp_word || ppp_stride ) return 0;
+	if ( ppp_maxmem ) {  /* each thread: a table, a block and a segment. */
+		int64_t per = ppp_WSIZE + (int64_t) ppp_blocksize * (fext.ppp_restart + 1);
+		while ( nt > 1 && ppp_memneed + nt * per > ppp_maxmem ) nt--;
+	}
+	if ( nt <= 1 || !load_seek_table() ) return 0;
+	
+	tp.infile = infile;
+	tp.next = 0;
+	tp.nseg = seek_n;
+	tp.nb = ppp_nblocks + (ppp_lastblocksize > 0);
+	tp.block_crc = (uint32_t *) calloc( tp.nb ? tp.nb : 1, sizeof(uint32_t) );
+	th = (pthread_t *) malloc( sizeof(pthread_t) * nt );
+	if ( !tp.block_crc || !th ) return 0;
+	pthread_mutex_init( &tp.lock, NULL );
+	for ( t = 0; t < nt; t++ ) pthread_create( &th[t], NULL, test_worker, NULL );
+	for ( t = 0; t < nt; t++ ) pthread_join( th[t], NULL );
+	pthread_mutex_destroy( &tp.lock );
+	
+	if ( fext.ppp_flags & PPP_CHECKSUM ) {
+		for ( i = 0; i < tp.nb; i++ ) {
+			b[0] = tp.block_crc[i], b[1] = tp.block_crc[i] >> 8;
+			b[2] = tp.block_crc[i] >> 16, b[3] = tp.block_crc[i] >> 24;
+			ppp_crc = crc32c( ppp_crc, b, 4 );
+		}
+		if ( ppp_crc != fext.ppp_crc ) {
+			fprintf(stderr, "\n stream hash mismatch.");
+			ppp_errors++;
+		}
+	}
+	fprintf(stderr, " (%d threads) ", nt );
+	free( tp.block_crc );
+	free( th );
+	return 1;
+#else
+	(void) infile;
+	return 0;
+#endif
+}
+
+/* ---- estimate ---- */
+
+static const int est_wbits[] = { 16, 18, 20, 21, 22, 24, 26 };
+#define EST_NWBITS  ((int) (sizeof(est_wbits) / sizeof(est_wbits[0])))
+
+static struct {
+	unsigned char **p;   /* the samples */
+	int *n;
+	int nsamples;
+	int64_t nbytes;      /* sampled */
+	int64_t hits[ 2*EST_NWBITS ];
+	double secs[ 2*EST_NWBITS ];
+	int next;
+#if defined( PPP_THREADS )
+	pthread_mutex_t lock;
+#endif
+} est;
+
+double wall_secs( void )
+{
+#if defined( PPP_THREADS )
+	struct timespec ts;
+	
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* configuration k: table est_wbits[k/2], hash k%2. */
+static void est_run( int k )
+{
+	int i;
+	int64_t prev = 0, wmask = ((int64_t) 1 << est_wbits[k/2]) - 1;
+	unsigned char *w = (unsigned char *) calloc( wmask+1, 1 );
+	int64_t hits = 0;
+	double t;
+	
+	if ( !w ) {
+		est.hits[k] = -1;
+		return;
+	}
+	t = wall_secs();
+	for ( i = 0; i < est.nsamples; i++ ) {
+		if ( k & 1 ) hits += count_hits_h( w, est.p[i], est.n[i], &prev, wmask, HASH_XOR );
+		else hits += count_hits_h( w, est.p[i], est.n[i], &prev, wmask, HASH_ADD );
+	}
+	est.secs[k] = wall_secs() - t;
+	est.hits[k] = hits;
+	free( w );
+}
+
+#if defined( PPP_THREADS )
+static void *est_worker( void *arg )
+{
+	int k;
+	
+	(void) arg;
+	while ( 1 ) {
+		pthread_mutex_lock( &est.lock );
+		k = est.next++;
+		pthread_mutex_unlock( &est.lock );
+		if ( k >= 2*EST_NWBITS ) break;
+		est_run( k );
+	}
+	return NULL;
+}
+#endif
+
+/* picks the samples: one EST_CHUNK at a random offset in each of
+	sample/EST_CHUNK equal spans of the file (the whole file if it is
+	no larger). The offsets are seeded from the size, so estimates of
+	one file repeat. Mapped where possible, read otherwise.
+*/
+int est_load( FILE *fp, int64_t size, int64_t sample, unsigned char **map )
+{
+	int64_t span, off, i;
+	uint64_t x = (uint64_t) size * 0x9e3779b97f4a7c15ULL + 1;
+	unsigned char *buf;
+	int chunk = EST_CHUNK;
+	
+	*map = NULL;
+	if ( size <= sample ) sample = size;
+	est.nsamples = (int) ((sample + chunk-1) / chunk);
+	if ( size <= sample ) span = chunk;
+	else span = size / est.nsamples;
+	est.p = (unsigned char **) calloc( est.nsamples, sizeof(unsigned char *) );
+	est.n = (int *) calloc( est.nsamples, sizeof(int) );
+	if ( !est.p || !est.n ) return 0;
+#if defined( PPP_MMAP )
+	*map = (unsigned char *) mmap( NULL, size, PROT_READ, MAP_PRIVATE, fileno( fp ), 0 );
+	if ( *map == MAP_FAILED ) *map = NULL;
+#endif
+	buf = *map ? NULL : (unsigned char *) malloc( (size_t) est.nsamples * chunk );
+	if ( !*map && !buf ) return 0;
+	for ( i = 0; i < est.nsamples; i++ ) {
+		off = i * span;
+		if ( span > chunk ) {  /* xorshift64 */
+			x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+			off += (int64_t) (x % (uint64_t) (span - chunk + 1));
+		}
+		est.n[i] = (int) (size - off < chunk ? size - off : chunk);
+		if ( *map ) est.p[i] = *map + off;
+		else {
+			est.p[i] = buf + i * (int64_t) chunk;
+			if ( gt_fseek( fp, off, SEEK_SET )
+				|| fread( est.p[i], 1, est.n[i], fp ) != (size_t) est.n[i] ) return 0;
+		}
+		est.nbytes += est.n[i];
+	}
+	return 1;
+}
+
+/* Predicts the ratio and the model speed of each table size and hash
+	from samples of the file, writing nothing. Each configuration runs
+	on its own table, on as many threads as there are cores; as the
+	samples are shorter than the file, the larger tables come out
+	somewhat pessimistic.
+*/
+int estimate( char *infile, int64_t sample )
+{
+	FILE *fp;
+	struct stat st;
+	unsigned char *map = NULL;
+	int64_t csize;
+	int k, best = 0, ok = 0, nt = ppp_nthreads;
+	
+	if ( (fp = fopen( infile, "rb" )) == NULL || fstat( fileno( fp ), &st ) || st.st_size <= 0 ) {
+		fprintf(stderr, "\nError opening input file.");
+		if ( fp ) fclose( fp );
+		return 0;
+	}
+	if ( !est_load( fp, (int64_t) st.st_size, sample, &map ) ) {
+		fprintf(stderr, "\n %s: can't read the samples.", infile );
+		goto done;
+	}
+	fprintf(stderr, "\n Estimating %s: %d samples, %lld of %lld bytes ...",
+		infile, est.nsamples, (long long) est.nbytes, (long long) st.st_size );
+#if defined( PPP_THREADS )
+	{
+		pthread_t th[ 2*EST_NWBITS ];
+		int t;
+		
+		if ( nt <= 0 ) nt = (int) sysconf( _SC_NPROCESSORS_ONLN );
+		if ( nt > 2*EST_NWBITS ) nt = 2*EST_NWBITS;
+		if ( nt < 1 ) nt = 1;
+		est.next = 0;
+		pthread_mutex_init( &est.lock, NULL );
+		for ( t = 0; t < nt; t++ ) pthread_create( &th[t], NULL, est_worker, NULL );
+		for ( t = 0; t < nt; t++ ) pthread_join( th[t], NULL );
+		pthread_mutex_destroy( &est.lock );
+	}
+#else
+	nt = 1;
+	for ( k = 0; k < 2*EST_NWBITS; k++ ) est_run( k );
+#endif
+	fprintf(stderr, "done (%d threads).\n", nt );
+	
+	/* a block codes as n/8 flag bytes and the mispredicted bytes. */
+	printf( "  bits  hash   ratio %%     MB/s\n" );
+	for ( k = 0; k < 2*EST_NWBITS; k++ ) {
+		if ( est.hits[k] < 0 ) continue;
+		csize = (est.nbytes+7)/8 + est.nbytes - est.hits[k];
+		printf( "  %4d  %4s  %7.2f  %7.1f\n", est_wbits[k/2], (k & 1) ? "xor" : "add",
+			100.0 * (est.nbytes - csize) / est.nbytes,
+			est.secs[k] > 0 ? est.nbytes / 1048576.0 / est.secs[k] : 0.0 );
+		if ( est.hits[k] > est.hits[best] ) best = k;
+	}
+	printf( "  best: c%d --hash %s\n", est_wbits[best/2], (best & 1) ? "xor" : "add" );
+	fflush( stdout );
+	ok = 1;
+	
+	done:
+#if defined( PPP_MMAP )
+	if ( map ) munmap( map, st.st_size );
+	else
+#endif
+	if ( est.p && est.nsamples ) free( est.p[0] );
+	free( est.p );
+	free( est.n );
+	fclose( fp );
+	return ok;
+}
+
+/* ---- Dictionaries ---- */
+
+/* Maps the dictionary read-only; sets ppp_WBITS and fext.ppp_dict_id. */
+int load_dict( char *dictname )
+{
+	dict_stamp ds;
+	FILE *fp;
+	
+	if ( (fp = fopen( dictname, "rb" )) == NULL ) {
+		fprintf(stderr, "\n Error opening dictionary %s.", dictname );
+		return 0;
+	}
+	if ( fread( &ds, sizeof(dict_stamp), 1, fp ) != 1 || strcmp( ds.alg, "LZPGTD" )
+		|| ds.ppp_WBITS < 15 || ds.ppp_WBITS > PPP_MAXWBITS ) {
+		fprintf(stderr, "\n %s: not an lzpgt7 dictionary.", dictname );
+		fclose( fp );
+		return 0;
+	}
+	ppp_WBITS = ds.ppp_WBITS;
+	ppp_hash = ds.ppp_hash ? HASH_XOR : HASH_ADD;
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
+	ppp_WMASK = (ppp_WSIZE-1);
+	fext.ppp_dict_id = ds.dict_id;
+#if defined( PPP_MMAP )
+	dict_fd = open( dictname, O_RDONLY );
+	if ( dict_fd >= 0 ) {
+		dict_map = (unsigned char *) mmap( NULL, ppp_WSIZE, PROT_READ, MAP_SHARED,
+			dict_fd, DICT_HDRSIZE );
+		if ( dict_map != MAP_FAILED ) {
+			fclose( fp );
+			return 1;
+		}
+		dict_map = NULL;
+		close( dict_fd );
+		dict_fd = -1;
+	}
+#endif
+	dict_map = (unsigned char *) malloc( ppp_WSIZE );
+	if ( !dict_map || gt_fseek( fp, DICT_HDRSIZE, SEEK_SET )
+		|| fread( dict_map, 1, ppp_WSIZE, fp ) != (size_t) ppp_WSIZE ) {
+		fprintf(stderr, "\n Error reading dictionary %s.", dictname );
+		free( dict_map );
+		dict_map = NULL;
+	}
+	fclose( fp );
+	return dict_map != NULL;
+}
+
+void free_dict( void )
+{
+	if ( !dict_map ) return;
+#if defined( PPP_MMAP )
+	if ( dict_fd >= 0 ) {
+		munmap( dict_map, ppp_WSIZE );
+		close( dict_fd );
+		dict_fd = -1;
+		dict_map = NULL;
+		return;
+	}
+#endif
+	free( dict_map );
+	dict_map = NULL;
+}
+
+/* A table ready for coding. With a mapped dictionary this is a private
+	(copy-on-write) mapping of it: streams share the dictionary pages
+	and only copy the ones they modify.
+*/
+unsigned char *alloc_table( void )
+{
+	unsigned char *w;
+	
+	win_buf_mapped = 0;
+	ppp_prev = 0;
+#if defined( PPP_MMAP )
+	if ( dict_fd >= 0 ) {
+		w = (unsigned char *) mmap( NULL, ppp_WSIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+			dict_fd, DICT_HDRSIZE );
+		if ( w != MAP_FAILED ) {
+			win_buf_mapped = 1;
+			return w;
+		}
+	}
+#endif
+#if defined( PPP_MMAP ) && defined( MAP_ANONYMOUS )
+	if ( ppp_WSIZE >= PPP_LAZYTABLE && !dict_map && !ref_table ) {
+		w = (unsigned char *) mmap( NULL, ppp_WSIZE, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0 );
+		if ( w != MAP_FAILED ) {
+			win_buf_mapped = 2;   /* zero pages until written. */
+	#if defined( MADV_HUGEPAGE )
+			madvise( w, ppp_WSIZE, MADV_HUGEPAGE );   /* fewer TLB misses. */
+	#endif
+			return w;
+		}
+	}
+#endif
+	w = (unsigned char *) malloc( sizeof(unsigned char) * ppp_WSIZE );
+	if ( w ) init_table( w );
+	return w;
+}
+
+/* the block buffers, for blocks of ppp_blocksize; see block_mem(). */
+int alloc_blocks( int encode )
+{
+	int n = ppp_blocksize;
+	
+	free_blocks();
+	pattern = (unsigned char *) malloc( n );
+	gbits = (unsigned char *) malloc( n/8 );
+	if ( encode ) cbuf = (unsigned char *) malloc( n );
+	if ( encode && (fext.ppp_flags & PPP_FILTER) ) fbuf = (unsigned char *) malloc( n );
+	if ( fext.ppp_flags & PPP_LZ ) lzbuf = (unsigned char *) malloc( LZ_MAXOUT( n ) );
+	return pattern && gbits && (cbuf || !encode) && (fbuf || !encode || !(fext.ppp_flags & PPP_FILTER))
+		&& (lzbuf || !(fext.ppp_flags & PPP_LZ));
+}
+
+void free_blocks( void )
+{
+	free( pattern ); free( gbits ); free( cbuf ); free( fbuf ); free( lzbuf );
+	pattern = gbits = cbuf = fbuf = lzbuf = NULL;
+}
+
+int64_t block_mem( int encode )
+{
+	int64_t n = ppp_blocksize, m = n + n/8;
+	
+	if ( encode ) m += n;
+	if ( encode && (fext.ppp_flags & PPP_FILTER) ) m += n;
+	if ( fext.ppp_flags & PPP_LZ ) m += LZ_MAXOUT( n );
+	if ( encode && (fext.ppp_flags & PPP_DEDUP) ) m += n;
+	if ( encode && (fext.ppp_flags & PPP_MODELS) ) m += mdl.n * (n/8 + n);
+	return m;
+}
+
+/* the tables: the coding table, the dictionary, the primed copy. */
+int64_t table_mem( void )
+{
+	int64_t w = (int64_t) 1 << ppp_WBITS;
+	
+	return w + ((fext.ppp_flags & PPP_DICT) ? w : 0)
+		+ ((fext.ppp_flags & (PPP_REF|PPP_RESTART)) == (PPP_REF|PPP_RESTART) ? w : 0)
+		+ ((fext.ppp_flags & PPP_MODELS) ? (mdl.n-1) * w : 0);
+}
+
+/* --max-mem, before anything large is allocated. c halves the block
+	down to 2^PPP_MINBLOCKBITS until the block buffers take at most
+	1/PPP_MEMBLOCK of the budget, then shrinks the table unless its
+	size was given; d and t can only check, the file fixes both.
+*/
+int fit_memory( int mode, int wbits_given, int use_direct )
+{
+	int64_t fixed = PPP_MEMBASE + (int64_t) pBUFSIZE + gBUFSIZE;
+	int encode = mode == COMPRESS;
+	
+	if ( use_direct ) fixed += (int64_t) DIO_NBUFS * DIO_BUFSIZE;
+	if ( fext.ppp_flags & PPP_DEDUP )  /* the chunk buffers and the first index; it grows. */
+		fixed += (encode ? 4*DD_MAXCHUNK : DD_MAXCHUNK) + ((int64_t) sizeof(dd_entry) << 16);
+	if ( encode ) {
+		while ( ppp_blocksize > (1<<PPP_MINBLOCKBITS) && block_mem( 1 ) > ppp_maxmem / PPP_MEMBLOCK )
+			ppp_blocksize >>= 1;
+		while ( !wbits_given && ppp_WBITS > 15 && fixed + block_mem( 1 ) + table_mem() > ppp_maxmem )
+			ppp_WBITS--;
+	}
+	ppp_memneed = fixed + block_mem( encode ) + table_mem();
+	if ( ppp_memneed > ppp_maxmem ) {
+		fprintf(stderr, "\n Needs %lld KB (table %d bits, block %d bytes), over --max-mem %lld KB.",
+			(long long) (ppp_memneed >> 10), ppp_WBITS, ppp_blocksize, (long long) (ppp_maxmem >> 10) );
+		return 0;
+	}
+	return 1;
+}
+
+/* sizes as N, NK, NM or NG; -1 if not a size or over 2^63-1. */
+int64_t parse_size( const char *s )
+{
+	char *end;
+	int64_t n;
+	int shift = 0;
+	
+	errno = 0;
+	n = strtoll( s, &end, 10 );
+	switch ( toupper( (unsigned char) *end ) ) {
+		case 'G': shift += 10;
+			/* fallthrough */
+		case 'M': shift += 10;
+			/* fallthrough */
+		case 'K': shift += 10; end++;
+	}
+	if ( *end || errno == ERANGE || n < 0 || n > (INT64_MAX >> shift) ) return -1;
+	return n << shift;
+}
+
+void report_memory( void )
+{
+#if defined( PPP_THREADS )
+	struct rusage ru;
+	
+	if ( getrusage( RUSAGE_SELF, &ru ) == 0 ) {
+	#if defined( __APPLE__ )
+		ru.ru_maxrss >>= 10;   /* bytes there, KB on Linux. */
+	#endif
+		fprintf(stderr, " Memory: peak %ld KB, planned %lld KB, budget %lld KB.\n",
+			(long) ru.ru_maxrss, (long long) (ppp_memneed >> 10), (long long) (ppp_maxmem >> 10) );
+	}
+#else
+	fprintf(stderr, " Memory: planned %lld KB, budget %lld KB.\n",
+		(long long) (ppp_memneed >> 10), (long long) (ppp_maxmem >> 10) );
+#endif
+}
+
+void free_table( unsigned char w[] )
+{
+#if defined( PPP_MMAP )
+	if ( win_buf_mapped ) {
+		munmap( w, ppp_WSIZE );
+		win_buf_mapped = 0;
+		return;
+	}
+#endif
+	free( w );
+}
+
+/* Trains a dictionary: for every context slot, the byte that most
+	often follows that context in the samples (majority vote, with a
+	count per slot). Each sample starts from a zero context hash, as
+	each compressed stream does.
+*/
+int dict_train( char *dictname, char *names[], int n )
+{
+	FILE *fp;
+	dict_stamp ds;
+	unsigned char *cand, *cnt, *p, *pend;
+	int64_t i, nbytes = 0, used = 0;
+	int c, nread;
+	int64_t prev;
+	
+	for ( i = 0; i < n; i++ ) add_argument( names[i] );
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
+	ppp_WMASK = (ppp_WSIZE-1);
+	cand = (unsigned char *) calloc( ppp_WSIZE, 1 );
+	cnt = (unsigned char *) calloc( ppp_WSIZE, 1 );
+	if ( !cand || !cnt ) {
+		fprintf(stderr, "\n Error alloc: Prediction Table (win_buf).");
+		exit(0);
+	}
+	fprintf(stderr, "\n Training [ %s ] (%d bits) ...", dictname, ppp_WBITS );
+	for ( i = 0; i < nmembers; i++ ) {
+		if ( (fp = fopen( members[i].name, "rb" )) == NULL ) {
+			fprintf(stderr, "\n Error opening %s, skipped.", members[i].name );
+			continue;
+		}
+		prev = 0;
+		while ( (nread = fread( pattern, 1, PPP_BLOCKSIZE, fp )) ) {
+			for ( p = pattern, pend = p + nread; p < pend; p++ ) {
+				c = *p;
+				if ( cnt[prev] == 0 ) cand[prev] = c, cnt[prev] = 1;
+				else if ( cand[prev] == c ) { if ( cnt[prev] < 255 ) cnt[prev]++; }
+				else cnt[prev]--;
+				prev = PPP_HASH( prev, c, ppp_hash ) & ppp_WMASK;
+			}
+			nbytes += nread;
+		}
+		fclose( fp );
+		free( members[i].name );
+	}
+	for ( i = 0; i < ppp_WSIZE; i++ ) used += (cnt[i] != 0);
+	
+	memset( &ds, 0, sizeof(ds) );
+	strcpy( ds.alg, "LZPGTD" );
+	ds.ppp_WBITS = ppp_WBITS;
+	ds.ppp_hash = ppp_hash;
+	ds.dict_id = crc32c( 0, cand, ppp_WSIZE );
+	if ( ds.dict_id == 0 ) ds.dict_id = 1;
+	if ( (fp = fopen( dictname, "wb" )) == NULL ) {
+		fprintf(stderr, "\nError opening output file.");
+		exit(0);
+	}
+	memset( cnt, 0, DICT_HDRSIZE );
+	memcpy( cnt, &ds, sizeof(ds) );
+	fwrite( cnt, DICT_HDRSIZE, 1, fp );
+	fwrite( cand, ppp_WSIZE, 1, fp );
+	if ( fclose( fp ) ) fprintf(stderr, "\n Error writing output file.");
+	fprintf(stderr, "done.\n  %lld samples (%lld) -> %s, id %08x, %lld of %lld slots primed",
+		(long long) nmembers, (long long) nbytes, dictname, (unsigned) ds.dict_id,
+		(long long) used, (long long) ppp_WSIZE );
+	free( cand ); free( cnt ); free( members );
+	return 1;
+}
+
+/* ---- Levels ---- */
+
+/* L2/L3 cache size in bytes, or 0 if unknown. */
+int64_t cache_size( int level )
+{
+	int64_t size = 0;
+	char fname[64], line[32];
+	FILE *fp;
+	
+#if defined( _SC_LEVEL2_CACHE_SIZE ) && defined( _SC_LEVEL3_CACHE_SIZE )
+	size = sysconf( level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE );
+	if ( size > 0 ) return size;
+#endif
+	sprintf( fname, "/sys/devices/system/cpu/cpu0/cache/index%d/size", level );
+	if ( (fp = fopen( fname, "r" )) != NULL ) {
+		if ( fgets( line, sizeof(line), fp ) ) {
+			size = atoll( line );
+			if ( strchr( line, 'K' ) ) size <<= 10;
+			else if ( strchr( line, 'M' ) ) size <<= 20;
+		}
+		fclose( fp );
+	}
+	return size > 0 ? size : 0;
+}
+
+int floor_log2( int64_t n )
+{
+	int k = 0;
+	
+	while ( n > 1 ) n >>= 1, k++;
+	return k;
+}
+
+/* Levels -1..-9: -1..-3 keep the table within the L2 cache and use
+	small blocks, -4..-6 keep it within (a share of) the L3, -7..-9 use
+	large tables and LZ coded literals for ratio. The table is never
+	made much larger than the input (insize < 0: unknown, e.g. a pipe),
+	and tables of 2^16 or less use the xor hash, which does better
+	there.
+*/
+void choose_level( int level, int64_t insize, int wbits_given, int hash_given )
+{
+	int64_t l2 = cache_size( 2 ), l3 = cache_size( 3 ), limit;
+	int wbits;
+	
+	if ( l2 == 0 ) l2 = 1 << 20;
+	if ( l3 == 0 ) l3 = 8 << 20;
+	switch ( level ) {
+		case 1: limit = l2/4; break;
+		case 2: limit = l2/2; break;
+		case 3: limit = l2; break;
+		case 4: limit = l3/4 < (1<<22) ? l3/4 : (1<<22); break;
+		case 5: limit = l3/2 < (1<<23) ? l3/2 : (1<<23); break;
+		case 6: limit = l3 < (1<<24) ? l3 : (1<<24); break;
+		case 7: limit = 1<<24; break;
+		case 8: limit = 1<<26; break;
+		default: limit = 1<<28; break;
+	}
+	wbits = floor_log2( limit );
+	if ( insize >= 0 && wbits > floor_log2( insize ) + 1 ) wbits = floor_log2( insize ) + 1;
+	if ( wbits < 15 ) wbits = 15;
+	else if ( wbits > 30 ) wbits = 30;
+	if ( !wbits_given ) ppp_WBITS = wbits;
+	
+	ppp_blocksize = 1 << (level <= 3 ? 16 : level <= 6 ? 18 : PPP_BLOCKBITS);
+	if ( !hash_given ) ppp_hash = (ppp_WBITS <= 16) ? HASH_XOR : HASH_ADD;
+	if ( level >= 7 ) fext.ppp_flags |= PPP_LZ;
+}
+
+/* ---- Delta mode ---- */
+
+/* Runs the reference file through the coder's table update, with no
+	output, so that data similar to it codes as hits. When decoding
+	(size >= 0) the reference must match the recorded size and crc;
+	the size is checked before reading it. When encoding, both are
+	recorded in fext.
+*/
+int prime_ref( unsigned char w[], char *refname, int64_t size, uint32_t crc )
+{
+	FILE *fp;
+	unsigned char *p, *pend;
+	int64_t n = 0;
+	uint32_t rcrc = 0;
+	int c, nread;
+	int64_t prev = 0;
+	
+	if ( (fp = fopen( refname, "rb" )) == NULL ) {
+		fprintf(stderr, "\n Error opening reference file %s.", refname );
+		return 0;
+	}
+	if ( size >= 0 ) {
+		gt_fseek( fp, 0, SEEK_END );
+		if ( gt_ftell( fp ) != size ) {
+			fprintf(stderr, "\n wrong reference file: %s is %lld bytes, expected %lld.",
+				refname, (long long) gt_ftell( fp ), (long long) size );
+			fclose( fp );
+			return 0;
+		}
+		gt_fseek( fp, 0, SEEK_SET );
+	}
+	while ( (nread = fread( pattern, 1, PPP_BLOCKSIZE, fp )) ) {
+		for ( p = pattern, pend = p + nread; p < pend; p++ ) {
+			w[prev] = c = *p;
+			prev = PPP_HASH( prev, c, ppp_hash ) & ppp_WMASK;
+		}
+		rcrc = crc32c( rcrc, pattern, nread );
+		n += nread;
+	}
+	fclose( fp );
+	ppp_prev = 0;
+	if ( size < 0 ) {
+		fext.ppp_ref_size = n;
+		fext.ppp_ref_crc = rcrc;
+	}
+	else if ( rcrc != crc ) {
+		fprintf(stderr, "\n wrong reference file: %s has crc %08x, expected %08x.",
+			refname, (unsigned) rcrc, (unsigned) crc );
+		return 0;
+	}
+	fprintf(stderr, "\n Reference %s (%lld bytes, crc %08x)", refname, (long long) n, (unsigned) rcrc );
+	
+	/* restart points go back to the primed table. */
+	if ( fext.ppp_flags & PPP_RESTART ) {
+		ref_table = (unsigned char *) malloc( ppp_WSIZE );
+		if ( !ref_table ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			return 0;
+		}
+		memcpy( ref_table, w, ppp_WSIZE );
+	}
+	return 1;
+}
+
+/* ---- Archive mode ---- */
+
+void add_member( const char *name )
+{
+	if ( nmembers == max_members ) {
+		max_members = max_members ? 2*max_members : 256;
+		members = (arc_member *) realloc( members, sizeof(arc_member) * max_members );
+		if ( !members ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+	}
+	memset( &members[nmembers], 0, sizeof(arc_member) );
+	members[nmembers].name = (char *) malloc( strlen(name)+1 );
+	if ( !members[nmembers].name ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		exit(0);
+	}
+	strcpy( members[nmembers].name, name );
+	members[nmembers].e.namelen = (int) strlen(name);
+	nmembers++;
+}
+
+int cmp_names( const void *a, const void *b )
+{
+	return strcmp( *(char * const *) a, *(char * const *) b );
+}
+
+/* adds the regular files under dir, recursively and in name order. */
+void add_directory( const char *dir )
+{
+	DIR *d;
+	struct dirent *de;
+	struct stat st;
+	char **names = NULL, *path;
+	int n = 0, max = 0, i;
+	
+	if ( (d = opendir( dir )) == NULL ) {
+		fprintf(stderr, "\n Error opening directory %s.", dir );
+		return;
+	}
+	while ( (de = readdir( d )) != NULL ) {
+		if ( !strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." ) ) continue;
+		if ( n == max ) {
+			max = max ? 2*max : 64;
+			names = (char **) realloc( names, sizeof(char *) * max );
+		}
+		path = (char *) malloc( strlen(dir) + strlen(de->d_name) + 2 );
+		if ( !names || !path ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+		sprintf( path, "%s/%s", dir, de->d_name );
+		names[n++] = path;
+	}
+	closedir( d );
+	qsort( names, n, sizeof(char *), cmp_names );
+	for ( i = 0; i < n; i++ ) {
+		if ( stat( names[i], &st ) == 0 ) {
+			if ( S_ISDIR( st.st_mode ) ) add_directory( names[i] );
+			else if ( S_ISREG( st.st_mode ) ) add_member( names[i] );
+		}
+		free( names[i] );
+	}
+	free( names );
+}
+
+/* a name, a directory, or @listfile (one name per line). */
+void add_argument( const char *arg )
+{
+	FILE *fp;
+	char line[4096];
+	struct stat st;
+	size_t k;
+	
+	if ( arg[0] == '@' ) {
+		if ( (fp = fopen( arg+1, "r" )) == NULL ) {
+			fprintf(stderr, "\n Error opening list file %s.", arg+1 );
+			return;
+		}
+		while ( fgets( line, sizeof(line), fp ) ) {
+			k = strlen( line );
+			while ( k && (line[k-1] == '\n' || line[k-1] == '\r') ) line[--k] = 0;
+			if ( k ) add_argument( line );
+		}
+		fclose( fp );
+	}
+	else if ( stat( arg, &st ) == 0 && S_ISDIR( st.st_mode ) ) {
+		add_directory( arg );
+	}
+	else add_member( arg );
+}
+
+/* the archive stamp keeps only the table size and solid: the members
+	are plain LZPGT7 streams, so no option may change their format.
+	the options users reach for most are refused by name, as is c_only,
+	the last option given that only c acts on: how the table starts,
+	the memory budget or how the output is written.
+*/
+int archive_options( const char *c_only )
+{
+	static const struct { int flag; const char *option; } refused[] = {
+		{ PPP_RESTART,  "--restart" },
+		{ PPP_CHECKSUM, "--check" },
+		{ PPP_FILTER,   "--filter" },
+		{ PPP_LZ,       "--lz" },
+		{ 0, NULL }
+	};
+	int i;
+	
+	if ( c_only ) {
+		fprintf(stderr, "\n archive: %s is for c only.", c_only );
+		return 0;
+	}
+	for ( i = 0; refused[i].option; i++ ) {
+		if ( fext.ppp_flags & refused[i].flag ) {
+			fprintf(stderr, "\n archive: %s is not kept in archives.", refused[i].option );
+			return 0;
+		}
+	}
+	if ( fext.ppp_flags || ppp_hash != HASH_ADD ) {
+		fprintf(stderr, "\n archive: plain LZPGT7 members only (no format options).");
+		return 0;
+	}
+	return 1;
+}
+
+int archive_create( char *arcname, char *names[], int n, int solid, int use_direct )
+{
+	archive_stamp astamp;
+	int64_t i, k = 0;
+	
+	for ( i = 0; i < n; i++ ) add_argument( names[i] );
+	if ( !open_put_file( arcname, use_direct ) ) {
+		fprintf(stderr, "\nError opening output file.");
+		return 0;
+	}
+	init_put_buffer();
+	memset( &astamp, 0, sizeof(astamp) );
+	strcpy( astamp.alg, "LZPGTA" );
+	pfwrite( &astamp, sizeof(archive_stamp) );
+	nbytes_out = sizeof(archive_stamp);
+	
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
+	ppp_WMASK = (ppp_WSIZE-1);
+	win_buf = (unsigned char *) malloc( sizeof(unsigned char) * ppp_WSIZE );
+	if ( !win_buf || (!solid && !tags_init()) ) {
+		fprintf(stderr, "\n Error alloc: Prediction Table (win_buf).");
+		goto halt_arc;
+	}
+	reset_table( win_buf );
+	
+	fprintf(stderr, "\n Prediction Table size used (%d bits)  = %lld bytes", ppp_WBITS, (long long) ppp_WSIZE );
+	fprintf(stderr, "\n\n Archiving [ %s ] (%s) ...", arcname, solid ? "solid" : "reset per member" );
+	nbytes_read = 0;
+	for ( i = 0; i < nmembers; i++ ) {
+		if ( (gIN=fopen( members[i].name, "rb" )) == NULL ) {
+			fprintf(stderr, "\n Error opening %s, skipped.", members[i].name );
+			free( members[i].name );
+			continue;
+		}
+		if ( !solid && k ) {
+			reset_table( win_buf );
+		}
+		members[k] = members[i];
+		members[k].e.offset = get_nbytes_out();
+		compress_LZP( win_buf, pattern );
+		members[k].e.usize = ppp_nblocks * ppp_blocksize + ppp_lastblocksize;
+		members[k].e.csize = get_nbytes_out() - members[k].e.offset;
+		fclose( gIN );
+		gIN = NULL;
+		k++;
+	}
+	nmembers = k;
+	flush_put_buffer();
+	
+	/* write the index, then the final archive stamp. */
+	astamp.nmembers = nmembers;
+	astamp.index_offset = nbytes_out;
+	astamp.ppp_WBITS = ppp_WBITS;
+	astamp.solid = solid;
+	for ( i = 0; i < nmembers; i++ ) {
+		pfwrite( &members[i].e, sizeof(member_entry) );
+		pfwrite( members[i].name, members[i].e.namelen );
+		nbytes_out += sizeof(member_entry) + members[i].e.namelen;
+		free( members[i].name );
+	}
+	rewrite_put_file( 0, &astamp, sizeof(archive_stamp) );
+	fprintf(stderr, "done.\n  %lld files (%lld) -> %s (%lld)",
+		(long long) nmembers, (long long) nbytes_read, arcname, (long long) nbytes_out );
+	
+	halt_arc:
+	
+	free_put_buffer();
+	if ( win_buf ) free( win_buf );
+	tags_free();
+	if ( close_put_file() ) fprintf(stderr, "\n Error writing output file.");
+	free( members );
+	return 1;
+}
+
+/* creates the parent directories of a member; refuses unsafe names. */
+int make_member_path( char *name )
+{
+	char *s;
+	
+	if ( name[0] == '/' || name[0] == '\\' || strstr( name, ".." ) ) return 0;
+	for ( s = name+1; *s; s++ ) {
+		if ( *s == '/' ) {
+			*s = 0;
+			make_dir( name );
+			*s = '/';
+		}
+	}
+	return 1;
+}
+
+int archive_extract( char *arcname, char *names[], int n, int list_only, int use_direct )
+{
+	archive_stamp astamp;
+	char *want = NULL;
+	int64_t i, last = -1;
+	int j;
+	
+	if ( (gIN=fopen( arcname, "rb" )) == NULL ) {
+		fprintf(stderr, "\nError opening input file.");
+		return 0;
+	}
+	if ( fread( &astamp, sizeof(archive_stamp), 1, gIN ) != 1
+		|| strcmp( astamp.alg, "LZPGTA" ) ) {
+		fprintf(stderr, "\n %s: not an lzpgt7 archive.", arcname );
+		fclose( gIN );
+		return 0;
+	}
+	
+	/* read the index. */
+	nmembers = astamp.nmembers;
+	members = (arc_member *) calloc( nmembers ? nmembers : 1, sizeof(arc_member) );
+	want = (char *) calloc( nmembers ? nmembers : 1, 1 );
+	if ( !members || !want ) {
+		fprintf(stderr, "\nmemory allocation error!");
+		exit(0);
+	}
+	gt_fseek( gIN, astamp.index_offset, SEEK_SET );
+	for ( i = 0; i < nmembers; i++ ) {
+		fread( &members[i].e, sizeof(member_entry), 1, gIN );
+		members[i].name = (char *) malloc( members[i].e.namelen+1 );
+		if ( !members[i].name ) {
+			fprintf(stderr, "\nmemory allocation error!");
+			exit(0);
+		}
+		fread( members[i].name, 1, members[i].e.namelen, gIN );
+		members[i].name[ members[i].e.namelen ] = 0;
+		if ( n == 0 ) want[i] = 1;
+		else for ( j = 0; j < n; j++ ) {
+			if ( !strcmp( names[j], members[i].name ) ) want[i] = 1;
+		}
+		if ( want[i] ) last = i;
+		if ( list_only ) {
+			fprintf(stderr, "\n %12lld %12lld  %s", (long long) members[i].e.usize,
+				(long long) members[i].e.csize, members[i].name );
+		}
+	}
+	if ( list_only ) goto halt_ext;
+	
+	ppp_WBITS = astamp.ppp_WBITS;
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
+	ppp_WMASK = (ppp_WSIZE-1);
+	win_buf = (unsigned char *) malloc( sizeof(unsigned char) * ppp_WSIZE );
+	if ( !win_buf || (!astamp.solid && !tags_init()) ) {
+		fprintf(stderr, "\n Error alloc: Prediction Table (win_buf).");
+		goto halt_ext;
+	}
+	reset_table( win_buf );
+	init_get_buffer();
+	init_put_buffer();
+	if ( nmembers ) seek_get_buffer( members[0].e.offset );
+	
+	/* a solid archive decodes every member up to the last one wanted,
+		writing only the wanted ones; otherwise we seek to each member.
+	*/
+	fprintf(stderr, "\n Extracting [ %s ] ...", arcname );
+	for ( i = 0; i <= last; i++ ) {
+		if ( !astamp.solid ) {
+			if ( !want[i] ) continue;
+			reset_table( win_buf );
+			seek_get_buffer( members[i].e.offset );
+		}
+		ppp_nblocks = members[i].e.usize / ppp_blocksize;
+		ppp_lastblocksize = (int) (members[i].e.usize % ppp_blocksize);
+		ppp_discard = !want[i];
+		if ( want[i] ) {
+			if ( !make_member_path( members[i].name ) ) {
+				fprintf(stderr, "\n unsafe member name %s, skipped.", members[i].name );
+				ppp_discard = 1;
+			}
+			else if ( !open_put_file( members[i].name, use_direct ) ) {
+				fprintf(stderr, "\n Error creating %s, skipped.", members[i].name );
+				ppp_discard = 1;
+			}
+		}
+		decompress_LZP( win_buf );
+		if ( !ppp_discard ) {
+			fprintf(stderr, "\n  %s (%lld)", members[i].name, (long long) members[i].e.usize );
+			if ( close_put_file() ) fprintf(stderr, "\n Error writing %s.", members[i].name );
+		}
+	}
+	ppp_discard = 0;
+	fprintf(stderr, "\n done." );
+	free_get_buffer();
+	free_put_buffer();
+	
+	halt_ext:
+	
+	for ( i = 0; i < nmembers; i++ ) free( members[i].name );
+	free( members );
+	free( want );
+	if ( win_buf ) free( win_buf );
+	tags_free();
+	fclose( gIN );
+	return 1;
+}
+
+/* ---- batch ----
+
+	Many small files, each to its own LZPGT7 file and back, with one
+	table, one set of buffers and a tagged (O(1)) reset between files:
+	batch_open() once, batch_file() per file, batch_close().
+*/
+
+/* a table for ppp_WBITS; decoding grows it for larger files. */
+int batch_open( int wbits )
+{
+	if ( win_buf && wbits <= ppp_WBITS ) return 1;
+	free( win_buf );
+	ppp_WBITS = wbits;
+	ppp_WSIZE = (int64_t) 1 << ppp_WBITS;
+	ppp_WMASK = (ppp_WSIZE-1);
+	win_buf = (unsigned char *) malloc( ppp_WSIZE );
+	if ( !win_buf || !tags_init() ) {
+		fprintf(stderr, "\n Error alloc: Prediction Table (win_buf).");
+		return 0;
+	}
+	return 1;
+}
+
+void batch_close( void )
+{
+	free( win_buf );
+	win_buf = NULL;
+	tags_free();
+}
+
+/* codes (or decodes) infile to outfile; 0 on an error. */
+int batch_file( char *infile, char *outfile, int decode, int *get_buffer )
+{
+	file_stamp fstamp;
+	int wbits = ppp_WBITS, ok = 1;
+	
+	if ( (gIN=fopen( infile, "rb" )) == NULL ) return 0;
+	if ( decode ) {
+		if ( fread( &fstamp, sizeof(file_stamp), 1, gIN ) != 1 || strcmp( fstamp.alg, "LZPGT7" )
+			|| fstamp.ppp_WBITS < 15 || fstamp.ppp_WBITS > PPP_MAXWBITS || fstamp.ppp_nblocks < 0 ) {
+			fprintf(stderr, "\n %s: not an lzpgt7 file, skipped.", infile );
+			fclose( gIN );
+			return 0;
+		}
+		if ( !batch_open( fstamp.ppp_WBITS ) ) exit(0);
+		ppp_WMASK = ((int64_t) 1 << fstamp.ppp_WBITS) - 1;
+		ppp_nblocks = fstamp.ppp_nblocks;
+		ppp_lastblocksize = fstamp.ppp_lastblocksize;
+	}
+	if ( !open_put_file( outfile, 0 ) ) {
+		fclose( gIN );
+		return 0;
+	}
+	reset_table( win_buf );
+	if ( decode ) {
+		if ( !*get_buffer ) init_get_buffer(), *get_buffer = 1;
+		seek_get_buffer( sizeof(file_stamp) );
+		decompress_LZP( win_buf );
+		ppp_WMASK = ppp_WSIZE-1;
+	}
+	else {
+		memset( &fstamp, 0, sizeof(fstamp) );
+		strcpy( fstamp.alg, "LZPGT7" );
+		pfwrite( &fstamp, sizeof(file_stamp) );
+		nbytes_out += sizeof(file_stamp);
+		compress_LZP( win_buf, pattern );
+		flush_put_buffer();
+		fstamp.ppp_nblocks = ppp_nblocks;
+		fstamp.ppp_lastblocksize = ppp_lastblocksize;
+		fstamp.ppp_WBITS = wbits;
+		rewrite_put_file( 0, &fstamp, sizeof(file_stamp) );
+	}
+	if ( close_put_file() ) ok = 0;
+	pOUT = NULL;
+	fclose( gIN );
+	gIN = NULL;
+	return ok;
+}
+
+/* the batch command: outdir/name.lzp for each input, or back. A
+	relative input path is kept under outdir; others lose their
+	directories.
+*/
+int batch_files( char *outdir, char *names[], int n, int decode )
+{
+	char *out, *name, *s;
+	int64_t i, nfiles = 0, in_total = 0, out_total = 0;
+	size_t len;
+	int get_buffer = 0;
+	
+	if ( fext.ppp_flags || ppp_hash != HASH_ADD ) {
+		fprintf(stderr, "\n batch: plain LZPGT7 files only (no format options).");
+		return 0;
+	}
+	for ( i = 0; i < n; i++ ) add_argument( names[i] );
+	make_dir( outdir );
+	if ( !batch_open( decode ? 15 : ppp_WBITS ) ) return 0;
+	init_put_buffer();
+	fprintf(stderr, "\n %s %lld files to %s ...", decode ? "Decoding" : "Encoding",
+		(long long) nmembers, outdir );
+	for ( i = 0; i < nmembers; i++ ) {
+		name = members[i].name;
+		if ( name[0] == '/' || name[0] == '\\' || strstr( name, ".." ) ) {
+			if ( (s = strrchr( name, '/' )) != NULL ) name = s+1;
+		}
+		while ( name[0] == '.' && name[1] == '/' ) name += 2;
+		out = (char *) malloc( strlen(outdir) + strlen(name) + 6 );
+		if ( !out ) break;
+		sprintf( out, "%s/%s", outdir, name );
+		len = strlen( out );
+		if ( !decode ) strcat( out, ".lzp" );
+		else if ( len > 4 && !strcmp( out + len-4, ".lzp" ) ) out[len-4] = 0;
+		else strcat( out, ".out" );
+		for ( s = out + strlen(outdir) + 1; *s; s++ ) {  /* parent directories */
+			if ( *s == '/' ) {
+				*s = 0;
+				make_dir( out );
+				*s = '/';
+			}
+		}
+		nbytes_read = nbytes_out = 0;
+		if ( batch_file( members[i].name, out, decode, &get_buffer ) ) {
+			nfiles++;
+			in_total += decode ? get_nbytes_read() : nbytes_read;
+			out_total += nbytes_out;
+		}
+		else fprintf(stderr, "\n %s: failed.", members[i].name );
+		free( out );
+		free( members[i].name );
+	}
+	fprintf(stderr, "done.\n  %lld files, %lld -> %lld bytes", (long long) nfiles,
+		(long long) in_total, (long long) out_total );
+	if ( get_buffer ) free_get_buffer();
+	free_put_buffer();
+	batch_close();
+	free( members );
+	members = NULL;
+	nmembers = max_members = 0;
+	return 1;
 }